@@ -0,0 +1,245 @@
+# Checks for 'make check', run in the directory of the build, one section
+# for each feature. Exits with a nonzero status on any failure.
+
+use IO::Socket::UNIX;
+use POSIX ":sys_wait_h";
+
+$tmp = "check.tmp";
+system("rm -rf $tmp");
+mkdir($tmp) or die "cannot create $tmp\n";
+$failed = 0;
+
+sub check {
+    my ($name, $ok) = @_;
+    print(($ok ? "ok" : "FAILED")." $name\n");
+    $failed++ if !$ok;
+}
+
+# Runs a command and returns its standard output, or undef on failure.
+sub run {
+    my $cmd = shift;
+    my $out = `$cmd`;
+    return $? == 0 ? $out : undef;
+}
+
+sub same {
+    my ($a, $b) = @_;
+    return defined($a) && defined($b) && $a ne "" && $a eq $b;
+}
+
+# Counts the output lines that match a pattern, -1 on failure.
+sub count {
+    my ($out, $re) = @_;
+    return defined($out) ? scalar(grep { /$re/ } split(/\n/, $out)) : -1;
+}
+
+# The pigeonhole formula for 4 pigeons and 3 holes.
+$php = "";
+$nc = 0;
+for($p = 0; $p < 4; $p++) {
+    $php .= join(" ", map { 1 + 3*$p + $_ } 0..2)." 0\n";
+    $nc++;
+}
+for($h = 0; $h < 3; $h++) {
+    for($p = 0; $p < 4; $p++) {
+        for($q = $p + 1; $q < 4; $q++) {
+            $php .= "-".(1 + 3*$p + $h)." -".(1 + 3*$q + $h)." 0\n";
+            $nc++;
+        }
+    }
+}
+$php = "p cnf 12 $nc\n".$php;
+open(F, ">$tmp/php.cnf") or die;
+print F $php;
+close(F);
+
+# Threads.
+for $f ("graph:6", "php:4:3", "ramsey:3:3:5") {
+    check("threads $f", 
+          same(run("./reduce -q -F $f"), run("./reduce -q -j 4 -F $f")));
+}
+check("threads php.cnf",
+      same(run("./reduce -q -l 6 -f $tmp/php.cnf"),
+           run("./reduce -q -j 4 -l 6 -f $tmp/php.cnf")));
+
+# Labeling the components apart.
+for $f ("graph:6", "ramsey:3:3:5") {
+    check("decompose $f",
+          same(run("./reduce -q -F $f"), run("./reduce -q -d -F $f")));
+}
+check("decompose php.cnf",
+      same(run("./reduce -q -l 6 -f $tmp/php.cnf"),
+           run("./reduce -q -d -l 6 -f $tmp/php.cnf")));
+
+# Collapsing twin vertices.
+for $f ("graph:6", "ramsey:3:3:5") {
+    check("twins $f",
+          same(run("./reduce -q -F $f"), run("./reduce -q -w -F $f")));
+}
+check("twins php.cnf",
+      same(run("./reduce -q -l 6 -f $tmp/php.cnf"),
+           run("./reduce -q -w -l 6 -f $tmp/php.cnf")));
+
+# The basic symmetry graph against the compact one.
+for $o ("-l 6", "-i -l 6") {
+    check("basic graph $o",
+          same(run("./reduce -q $o -f $tmp/php.cnf"),
+               run("./reduce -q -b $o -f $tmp/php.cnf")));
+}
+
+# Strategies. With all variables in the prefix, the cubes are the 87
+# orbits of the 4 x 3 matrices under row and column permutations, and 
+# the graphs on 5 vertices fall into 34 isomorphism classes.
+for $s ("default", "smallest", "occurrence", "stabilizer", "lookahead") {
+    check("select $s php.cnf", 
+          count(run("./reduce -q -i -l 12 -S $s -f $tmp/php.cnf"), 
+                qr/^a /) == 87);
+    next if $s eq "occurrence";
+    check("select $s graph:5", 
+          count(run("./reduce -q -S $s -F graph:5"), qr/^\d+: /) == 34);
+}
+
+# The estimate against the number of cubes.
+$n = count(run("./reduce -q -i -l 6 -f $tmp/php.cnf"), qr/^a /);
+$out = run("./reduce -q -e 50 -l 6 -f $tmp/php.cnf 2>&1");
+check("estimate", 
+      defined($out) && 
+      $out =~ /^c estimate: probes = 50, cubes = (\d+) \+- (\d+)/m &&
+      abs($1 - $n) <= 3*$2 + 1);
+
+# Passthrough, on an input with a comment and extra blanks, which the
+# copied clauses keep.
+open(F, ">$tmp/blank.cnf") or die;
+print F "c pigeons and holes\n";
+for(split(/^/, $php)) {
+    s/ /\t /g if !/^p /;
+    print F $_;
+}
+close(F);
+$out = run("./reduce -q -P -l 6 -f $tmp/blank.cnf");
+$out =~ s/\t / /g if defined($out);
+check("passthrough", same(run("./reduce -q -l 6 -f $tmp/blank.cnf"), $out));
+
+# Binary cubes, with the literals sorted by variable as in the stream.
+$icnf = run("./reduce -q -l 6 -i -f $tmp/php.cnf");
+$cubes = "";
+for(split(/\n/, $icnf)) {
+    next if !/^a /;
+    my @l = split(/ /);
+    @l = sort { abs($a) <=> abs($b) } @l[1..$#l-1];
+    $cubes .= "a @l 0\n";
+}
+run("./reduce -q -l 6 -c binary -f $tmp/php.cnf -o $tmp/php.bin");
+check("binary cubes", same(run("./cubecat $tmp/php.bin"), $cubes));
+check("binary cubes with -i", 
+      !defined(run("./reduce -q -l 6 -i -c binary -f $tmp/php.cnf ".
+                   "-o $tmp/php.bin 2>/dev/null")));
+
+# Compressed output, read back from the file and from a pipe.
+run("./reduce -q -l 6 -f $tmp/php.cnf -o $tmp/out.cnf");
+$plain = run("./reduce -q -l 6 -f $tmp/out.cnf");
+for $z ("gz", "xz", "zst") {
+    $msg = `./reduce -q -l 6 -f $tmp/php.cnf -o $tmp/out.cnf.$z 2>&1`;
+    if($msg =~ /not compiled in/) {
+        print "skipped $z (not compiled in)\n";
+        next;
+    }
+    open(F, "<$tmp/out.cnf.$z") or die;
+    read(F, $head, 5);
+    close(F);
+    check("compressed $z", 
+          $head ne "p cnf" &&
+          same(run("./reduce -q -l 6 -f $tmp/out.cnf.$z"), $plain) &&
+          same(run("cat $tmp/out.cnf.$z | ./reduce -q -l 6"), $plain));
+}
+
+# The library.
+check("example", defined(run("./example")));
+
+# The solver path with the stub solver.
+$out = run("./reduce-stub -q -A -l 6 -f $tmp/php.cnf");
+check("solve php", defined($out) && $out =~ /^s UNSATISFIABLE$/m);
+$out = run("./reduce-stub -q -A -F ramsey:3:3:5");
+check("solve ramsey", defined($out) && $out =~ /^s SATISFIABLE$/m);
+
+# Batch mode, against single runs.
+run("./reduce -q -l 6 -f $tmp/php.cnf -o $tmp/php6.cnf");
+$want = "";
+$i = 0;
+for $f ("php.cnf", "php6.cnf", "php.cnf") {
+    $out = run("./reduce -q -i -l 6 -f $tmp/$f");
+    $want .= "c instance ".++$i." ".count($out, qr/^a /)."\n".
+             join("", grep { /^a / } split(/^/, $out));
+}
+run("cat $tmp/php.cnf $tmp/php6.cnf $tmp/php.cnf > $tmp/batch.cnf");
+for $n (1, 3) {
+    check("batch $n", same(run("./reduce -q -l 6 -B $n -f $tmp/batch.cnf"),
+                           $want));
+}
+
+# Server.
+$sock = "$tmp/server.sock";
+$pid = fork();
+if($pid == 0) {
+    exec("./reduce", "-q", "-l", "6", "-D", $sock);
+    exit(1);
+}
+for($i = 0; $i < 100 && !-S $sock; $i++) {
+    select(undef, undef, undef, 0.1);
+}
+
+# Sends one request and returns the status and the reply.
+sub request {
+    my ($c, $header, $text) = @_;
+    print $c $header."\n".$text;
+    my $line = <$c>;
+    return ("", "") if !defined($line) || $line !~ /^(\w+) (\d+)$/;
+    my ($status, $len) = ($1, $2);
+    my $reply = "";
+    read($c, $reply, $len) == $len or return ("", "");
+    return ($status, $reply);
+}
+
+$c = IO::Socket::UNIX->new(Type => SOCK_STREAM, Peer => $sock);
+if(!defined($c)) {
+    check("server", 0);
+} else {
+    $c->autoflush(1);
+    my $want = join("", grep { /^a / } split(/^/, $icnf));
+    my ($s, $r) = request($c, "cubes 0 ".length($php), $php);
+    check("server cubes", $s eq "ok" && same($r, $want));
+    ($s, $r) = request($c, "orbits ".length($php), $php);
+    check("server orbits", $s eq "ok" && $r ne "");
+    ($s, $r) = request($c, "cubes 0 5", "hello");
+    check("server bad instance", $s eq "error");
+    ($s, $r) = request($c, "orbits 999999999999999", "");
+    check("server large request", $s eq "error");
+    close($c);
+    $c = IO::Socket::UNIX->new(Type => SOCK_STREAM, Peer => $sock);
+    ($s, $r) = defined($c) ? request($c, "shutdown 0", "") : ("", "");
+    check("server shutdown", $s eq "ok");
+    close($c) if defined($c);
+}
+for($i = 0; $i < 100 && waitpid($pid, WNOHANG) == 0; $i++) {
+    select(undef, undef, undef, 0.1);
+}
+if($i == 100) {
+    kill("TERM", $pid);
+    waitpid($pid, 0);
+    check("server exit", 0);
+} else {
+    check("server exit", $? == 0);
+}
+
+# Families, against the instance in a file and with the input options.
+check("family php:4:3",
+      same(run("./reduce -q -l 6 -F php:4:3"),
+           run("./reduce -q -l 6 -f $tmp/php.cnf")));
+for $o ("-f $tmp/php.cnf", "-n", "-g", "-b", "-P") {
+    check("family with $o", 
+          !defined(run("./reduce -q -l 6 -F php:4:3 $o 2>/dev/null")));
+}
+
+system("rm -rf $tmp");
+print $failed ? "$failed checks failed\n" : "all checks passed\n";
+exit($failed ? 1 : 0);
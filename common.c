@@ -78,6 +78,7 @@ void common_abort(const char *fn, int line, const char *func,
     vfprintf(stderr, format, args);
     fprintf(stderr, "\n");
     va_end(args);
+    fflush(stderr);
     abort();    
 }
 
@@ -117,23 +118,61 @@ void *common_malloc_wrapper(size_t size)
     void *p = malloc(size);
     if(p == NULL)
         ABORT("malloc fails");
-    common_malloc_balance++;
+    __atomic_fetch_add(&common_malloc_balance, 1, __ATOMIC_RELAXED);
     return p;
 }
 
 void common_free_wrapper(void *p)
 {
     free(p);
-    common_malloc_balance--;
+    __atomic_fetch_sub(&common_malloc_balance, 1, __ATOMIC_RELAXED);
+}
+
+/****************************************************************** Logging. */
+
+#define LOG_BUFFER_SIZE (1 << 16)
+
+int common_log_level = LOG_INFO;
+
+static const char *log_level_names[] = { "quiet", "info", "debug", "trace" };
+
+void log_set_level(int level)
+{
+    if(level < LOG_QUIET || level > LOG_TRACE)
+        ABORT("bad log level (%d)", level);
+    common_log_level = level;
+}
+
+int log_parse_level(const char *s)
+{
+    for(int l = LOG_QUIET; l <= LOG_TRACE; l++)
+        if(!strcmp(s, log_level_names[l]))
+            return l;
+    ERROR("unknown log level '%s'", s);
+    return LOG_QUIET;
+}
+
+/* Makes stderr fully buffered. Must be called before any output to stderr;
+ * the buffer is flushed at phase boundaries with log_flush() and on exit. */
+
+void log_buffer(void)
+{
+    static char buf[LOG_BUFFER_SIZE];
+    setvbuf(stderr, buf, _IOFBF, LOG_BUFFER_SIZE);
+}
+
+void log_flush(void)
+{
+    fflush(stderr);
 }
 
 /****************************************************************** Timings. */
 
 #define TIME_STACK_CAPACITY 256
 
-clock_t time_stack[TIME_STACK_CAPACITY];
-int     time_stack_top = -1;
-int     do_time        = 0;
+THREAD_LOCAL clock_t time_stack[TIME_STACK_CAPACITY];
+THREAD_LOCAL int     time_stack_top = -1;
+THREAD_LOCAL int     do_time        = 0;
 
 void enable_timing(void)
 {
@@ -170,8 +209,8 @@ double pop_time(void)
 void pop_print_time(const char *legend)
 {
     if(do_time) {
-        fprintf(stderr, " {%s: %.2fms}", legend, pop_time());
-        fflush(stderr);
+        double t = pop_time();
+        LOG(LOG_INFO, " {%s: %.2fms}", legend, t);
     }
 }
 
@@ -190,7 +229,7 @@ void print_int_array(FILE *out, int l, const int *a)
     for(int cursor = 0; cursor < l; cursor++) {
         int lookahead = cursor + 1;
         for(; 
-            a[lookahead-1]+1 == a[lookahead] && lookahead < l; 
+            lookahead < l && a[lookahead-1]+1 == a[lookahead]; 
             lookahead++)
             ;
         if(lookahead - cursor > 5) {
@@ -208,6 +247,102 @@ void print_int_array(FILE *out, int l, const int *a)
     }
 }
 
+/********************************************************** Buffered output. */
+
+const char common_digit_pairs[201] = 
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+outbuf_t *outbuf_alloc(FILE *out)
+{
+    outbuf_t *b = (outbuf_t *) MALLOC(sizeof(outbuf_t));
+    b->out = out;
+    b->buf = (char *) MALLOC(OUTBUF_SIZE);
+    b->len = 0;
+    return b;
+}
+
+void outbuf_free(outbuf_t *b)
+{
+    outbuf_flush(b);
+    FREE(b->buf);
+    FREE(b);
+}
+
+void outbuf_flush(outbuf_t *b)
+{
+    if(b->len > 0 && fwrite(b->buf, 1, b->len, b->out) != (size_t) b->len)
+        ERROR("file error writing output");
+    b->len = 0;
+}
+
+void outbuf_write(outbuf_t *b, const char *s, long l)
+{
+    if(b->len + l + OUTBUF_SLACK > OUTBUF_SIZE) {
+        outbuf_flush(b);
+        if(l + OUTBUF_SLACK > OUTBUF_SIZE) {
+            if(fwrite(s, 1, l, b->out) != (size_t) l)
+                ERROR("file error writing output");
+            return;
+        }
+    }
+    memcpy(b->buf + b->len, s, l);
+    b->len += l;
+}
+
+/********************************************************** Packed bitsets. */
+
+bitset_t *bitset_alloc(int n)
+{
+    bitset_t *b = (bitset_t *) MALLOC(sizeof(bitset_t)*BITSET_WORDS(n));
+    bitset_clear(n, b);
+    return b;
+}
+
+void bitset_clear(int n, bitset_t *b)
+{
+    int w = BITSET_WORDS(n);
+    for(int i = 0; i < w; i++)
+        b[i] = 0;
+}
+
+/* Returns the least element at least i in b, or -1 if there is none. */
+
+int bitset_next(int n, const bitset_t *b, int i)
+{
+    if(i < 0)
+        i = 0;
+    if(i >= n)
+        return -1;
+    int w = i/BITSET_WORD_BITS;
+    bitset_t x = b[w] & (~0ULL << (i%BITSET_WORD_BITS));
+    int nw = BITSET_WORDS(n);
+    while(x == 0) {
+        if(++w >= nw)
+            return -1;
+        x = b[w];
+    }
+    i = w*BITSET_WORD_BITS + __builtin_ctzll(x);
+    return i < n ? i : -1;
+}
+
+int bitset_count(int n, const bitset_t *b)
+{
+    int w = BITSET_WORDS(n);
+    int c = 0;
+    for(int i = 0; i < w; i++)
+        c += __builtin_popcountll(b[i]);
+    return c;
+}
+
 /****************************************************************** Sorting. */
 
 /******************************************* Shellsort for an integer array. */
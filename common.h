@@ -42,12 +42,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 #define MALLOC(x)  common_malloc_wrapper(x)
 #define FREE(x)    common_free_wrapper(x)
 #define ERROR(...) common_error(__FILE__,__LINE__,__func__,__VA_ARGS__);
 #define ABORT(...) common_abort(__FILE__,__LINE__,__func__,__VA_ARGS__);
 #define FPRINTF(...) common_fprintf(__FILE__,__LINE__,__func__,__VA_ARGS__);
+
+/* State private to each thread, such as the labeling caches and the timing
+ * stack; timing is on only in the thread that enabled it. (A GCC/Clang 
+ * extension; nauty must likewise be built with TLS for the labeling to run
+ * in several threads at once.) */
+
+#define THREAD_LOCAL __thread
+
+/* Diagnostics go to stderr at one of the following levels. */
+
+#define LOG_QUIET  0
+#define LOG_INFO   1
+#define LOG_DEBUG  2
+#define LOG_TRACE  3
+
+#define LOGGING(l) (common_log_level >= (l))
+#define LOG(l,...) (LOGGING(l) ? (void) fprintf(stderr, __VA_ARGS__) : (void) 0)
     
 void          common_error            (const char *fn, 
                                        int line, 
@@ -71,6 +89,12 @@ void          common_free_wrapper     (void *p);
 void          common_check_balance    (void);
 extern int    common_malloc_balance;
 
+extern int    common_log_level;
+void          log_set_level           (int level);
+int           log_parse_level         (const char *s);
+void          log_buffer              (void);
+void          log_flush               (void);
+
 void          enable_timing           (void);
 void          disable_timing          (void);
 void          push_time               (void);
@@ -79,6 +103,89 @@ void          pop_print_time          (const char *legend);
 
 void          print_int_array         (FILE *out, int l, const int *a);
 
+/* Buffered output with one error check per flush. The hot paths are 
+ * inline; a flush happens when fewer than OUTBUF_SLACK bytes are free. */
+
+#define OUTBUF_SIZE  (1L << 20)
+#define OUTBUF_SLACK 32
+
+typedef struct outbuf_struct
+{
+    FILE  *out;
+    char  *buf;
+    long  len;
+} outbuf_t;
+
+outbuf_t *    outbuf_alloc            (FILE *out);
+void          outbuf_free             (outbuf_t *b);
+void          outbuf_flush            (outbuf_t *b);
+void          outbuf_write            (outbuf_t *b, const char *s, long l);
+
+extern const char common_digit_pairs[201];
+
+/* Writes x in decimal to s, returns the number of characters written. */
+
+static inline int format_long(char *s, long x)
+{
+    char t[24];
+    int n = 0;
+    unsigned long u = x < 0 ? -(unsigned long) x : (unsigned long) x;
+    while(u >= 100) {
+        const char *d = common_digit_pairs + 2*(u % 100);
+        u /= 100;
+        t[n++] = d[1];
+        t[n++] = d[0];
+    }
+    if(u >= 10) {
+        t[n++] = common_digit_pairs[2*u+1];
+        t[n++] = common_digit_pairs[2*u];
+    } else {
+        t[n++] = (char) ('0' + u);
+    }
+    int m = 0;
+    if(x < 0)
+        s[m++] = '-';
+    while(n > 0)
+        s[m++] = t[--n];
+    return m;
+}
+
+static inline void outbuf_putc(outbuf_t *b, char c)
+{
+    if(b->len + OUTBUF_SLACK > OUTBUF_SIZE)
+        outbuf_flush(b);
+    b->buf[b->len++] = c;
+}
+
+static inline void outbuf_long(outbuf_t *b, long x)
+{
+    if(b->len + OUTBUF_SLACK > OUTBUF_SIZE)
+        outbuf_flush(b);
+    b->len += format_long(b->buf + b->len, x);
+}
+
+static inline void outbuf_puts(outbuf_t *b, const char *s)
+{
+    outbuf_write(b, s, (long) strlen(s));
+}
+
+/* Packed bitsets over {0,1,...,n-1}. */
+
+typedef unsigned long long bitset_t;
+
+#define BITSET_WORD_BITS    64
+#define BITSET_WORDS(n)     (((n)+BITSET_WORD_BITS-1)/BITSET_WORD_BITS)
+#define BITSET_WD(i)        ((i)/BITSET_WORD_BITS)
+#define BITSET_BT(i)        (1ULL<<((i)%BITSET_WORD_BITS))
+#define BITSET_TEST(b,i)    (((b)[BITSET_WD(i)] & BITSET_BT(i)) != 0)
+#define BITSET_ADD(b,i)     ((b)[BITSET_WD(i)] |= BITSET_BT(i))
+#define BITSET_DEL(b,i)     ((b)[BITSET_WD(i)] &= ~BITSET_BT(i))
+
+bitset_t *    bitset_alloc            (int n);
+void          bitset_clear            (int n, bitset_t *b);
+int           bitset_next             (int n, const bitset_t *b, int i);
+int           bitset_count            (int n, const bitset_t *b);
+
 void          shellsort_int           (int n, int *a);
 void          heapsort_int            (int n, int *a);
 void          heapsort_long           (long n, long *a);
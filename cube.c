@@ -0,0 +1,172 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/****************************************************** Binary cube streams. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "cube.h"
+
+/******************************************************************* Writer. */
+
+static void put_varint(outbuf_t *b, unsigned long x)
+{
+    while(x >= 0x80) {
+        outbuf_putc(b, (char) (0x80 | (x & 0x7F)));
+        x >>= 7;
+    }
+    outbuf_putc(b, (char) x);
+}
+
+void cube_write_header(outbuf_t *b, int nv)
+{
+    outbuf_write(b, CUBE_MAGIC, 4);
+    outbuf_putc(b, CUBE_VERSION);
+    put_varint(b, (unsigned long) nv);
+}
+
+void cube_write(outbuf_t *b, int d, int *lits, int aut)
+{
+    if(d < 1)
+        ABORT("empty cube");
+    /* Insertion sort by variable; cubes are short. */
+    for(int i = 1; i < d; i++) {
+        int l = lits[i];
+        int j = i;
+        for(; j > 0 && abs(lits[j-1]) > abs(l); j--)
+            lits[j] = lits[j-1];
+        lits[j] = l;
+    }
+    put_varint(b, (unsigned long) d);
+    put_varint(b, (unsigned long) aut);
+    int y = 0;
+    for(int i = 0; i < d; i++) {
+        int x = abs(lits[i]);
+        if(x <= y)
+            ABORT("repeated variable (%d) in cube", x);
+        put_varint(b, 2*(unsigned long) (x - y - 1) + (lits[i] < 0));
+        y = x;
+    }
+}
+
+void cube_write_end(outbuf_t *b)
+{
+    put_varint(b, 0);
+}
+
+/******************************************************************* Reader. */
+
+struct cubestream_struct
+{
+    FILE  *in;
+    int   nv;
+    int   capacity;
+    int   *lits;
+};
+
+static unsigned long get_varint(FILE *in)
+{
+    unsigned long x = 0;
+    int shift = 0;
+    int c;
+    do {
+        if((c = getc(in)) == EOF)
+            ERROR("unexpected end of cube stream");
+        if(shift > 56)
+            ERROR("bad varint in cube stream");
+        x |= ((unsigned long) (c & 0x7F)) << shift;
+        shift += 7;
+    } while(c & 0x80);
+    return x;
+}
+
+cubestream_t *cubestream_open(FILE *in)
+{
+    char magic[4];
+    if(fread(magic, 1, 4, in) != 4 || memcmp(magic, CUBE_MAGIC, 4) != 0)
+        ERROR("not a cube stream");
+    if(getc(in) != CUBE_VERSION)
+        ERROR("unsupported cube stream version");
+    cubestream_t *s = (cubestream_t *) MALLOC(sizeof(cubestream_t));
+    s->in = in;
+    s->nv = (int) get_varint(in);
+    s->capacity = 64;
+    s->lits = (int *) MALLOC(sizeof(int)*s->capacity);
+    return s;
+}
+
+void cubestream_close(cubestream_t *s)
+{
+    FREE(s->lits);
+    FREE(s);
+}
+
+int cubestream_num_vars(cubestream_t *s)
+{
+    return s->nv;
+}
+
+/* Returns the literals of the next cube, sorted by variable, and sets 
+ * d and aut. Returns NULL at the end of the stream. The literals are 
+ * valid until the next call. */
+
+const int *cubestream_next(cubestream_t *s, int *d, int *aut)
+{
+    unsigned long dd = get_varint(s->in);
+    if(dd == 0)
+        return NULL;
+    if(dd > (unsigned long) s->nv)
+        ERROR("bad cube length (%lu) in cube stream", dd);
+    if(dd > (unsigned long) s->capacity) {
+        FREE(s->lits);
+        s->capacity = (int) dd;
+        s->lits = (int *) MALLOC(sizeof(int)*s->capacity);
+    }
+    *d = (int) dd;
+    *aut = (int) get_varint(s->in);
+    unsigned long y = 0;
+    for(int i = 0; i < *d; i++) {
+        unsigned long z = get_varint(s->in);
+        unsigned long x = y + (z >> 1) + 1;
+        if(x > (unsigned long) s->nv)
+            ERROR("bad variable (%lu) in cube stream", x);
+        s->lits[i] = (z & 1) ? -(int) x : (int) x;
+        y = x;
+    }
+    return s->lits;
+}
@@ -0,0 +1,77 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/****************************************************** Binary cube streams. */
+
+#ifndef CUBE_READ
+#define CUBE_READ
+
+#include <stdio.h>
+#include "common.h"
+
+/* A cube stream is a header record followed by one record per cube and 
+ * an end record. All integers are unsigned LEB128 varints.
+ *
+ *   header:  the four bytes "RCUB", a version byte (1), and the number 
+ *            of variables of the CNF instance
+ *   cube:    the number of literals d >= 1, the truncated |Aut| of the 
+ *            cube, and then the d literals sorted by variable, each coded
+ *            as 2*(x - y - 1) + s, where x is the variable, y is the 
+ *            variable of the previous literal (0 for the first), and s is
+ *            1 for a negative literal
+ *   end:     a zero 
+ */
+
+#define CUBE_MAGIC   "RCUB"
+#define CUBE_VERSION 1
+
+/* Writer. The literals of a cube are sorted in place. */
+
+void          cube_write_header       (outbuf_t *b, int nv);
+void          cube_write              (outbuf_t *b, int d, int *lits, int aut);
+void          cube_write_end          (outbuf_t *b);
+
+/* Reader. */
+
+struct        cubestream_struct;
+typedef       struct cubestream_struct cubestream_t;
+
+cubestream_t *cubestream_open         (FILE *in);
+void          cubestream_close        (cubestream_t *s);
+int           cubestream_num_vars     (cubestream_t *s);
+const int *   cubestream_next         (cubestream_t *s, int *d, int *aut);
+
+#endif
@@ -0,0 +1,74 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/**************************************** Binary cube streams as iCNF cubes. */
+
+/* 
+ * Reads a binary cube stream (cf. 'cube.h') from the given file or the
+ * standard input, compressed or not, and writes each cube as an iCNF 
+ * line 'a <literals> 0', with the literals sorted by variable.
+ */
+
+#include <stdio.h>
+#include "common.h"
+#include "cube.h"
+#include "zio.h"
+
+int main(int argc, char **argv)
+{
+    if(argc > 2) {
+        fprintf(stderr, "usage: %s [<file>]\n", argv[0]);
+        return 1;
+    }
+    FILE *in = zio_open(argc == 2 ? argv[1] : NULL, "r");
+    outbuf_t *out = outbuf_alloc(stdout);
+    cubestream_t *s = cubestream_open(in);
+    const int *lits;
+    int d, aut;
+    while((lits = cubestream_next(s, &d, &aut)) != NULL) {
+        outbuf_putc(out, 'a');
+        for(int i = 0; i < d; i++) {
+            outbuf_putc(out, ' ');
+            outbuf_long(out, lits[i]);
+        }
+        outbuf_puts(out, " 0\n");
+    }
+    cubestream_close(s);
+    outbuf_free(out);
+    zio_close(in);
+    common_check_balance();
+    return 0;
+}
@@ -0,0 +1,191 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/***************************************** Example of the library interface. */
+
+/* 
+ * Lists the graphs on five points up to isomorphism through the graph
+ * interface, and the cubes of the pigeonhole formula for four pigeons and 
+ * three holes through the CNF interface, once with each iterator. Exits
+ * with a nonzero status unless there are 34 graphs, both iterators 
+ * give the same cubes, and the pull iterator stays at its end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+#include "reduce.h"
+
+#define POINTS  5
+#define PIGEONS 4
+#define HOLES   3
+
+/* The graph of the pairs of points, with a vertex for each pair joined 
+ * to its two points; the pairs are the variables. */
+
+static long graphs(void)
+{
+    int v = POINTS*(POINTS - 1)/2;
+    int n = v + 2 + POINTS;
+    graph_t *g = graph_alloc(n);
+    int *colors = (int *) malloc(sizeof(int)*n);
+    int *var = (int *) malloc(sizeof(int)*v);
+    int val[2] = { v, v + 1 };
+    int e = 0;
+    for(int i = 0; i < POINTS; i++) {
+        for(int j = i + 1; j < POINTS; j++) {
+            graph_add_edge(g, e, v + 2 + i);
+            graph_add_edge(g, e, v + 2 + j);
+            var[e] = e;
+            e++;
+        }
+    }
+    for(int u = 0; u < n; u++)
+        colors[u] = u < v ? 0 : (u < v + 2 ? u - v + 1 : 3);
+
+    reducer_t *r = reducer_alloc_graph(g, colors, v, var, 2, val);
+    reducer_set_prefix(r, v, var);
+    int *cube = (int *) malloc(sizeof(int)*reducer_cube_capacity(r));
+    long count = 0;
+    int d, aut;
+    while(reducer_next_cube(r, &d, cube, &aut)) {
+        int edges = 0;
+        for(int i = 0; i < d; i++)
+            edges += cube[d + i] == val[1];
+        printf("graph %ld: %d edges, |Aut| = %d\n", count + 1, edges, aut);
+        count++;
+    }
+    free(cube);
+    reducer_free(r);
+    free(var);
+    free(colors);
+    return count;
+}
+
+/* Pigeon p is in hole h if and only if variable 1 + p*HOLES + h is true. */
+
+static int *pigeonhole(long *nc)
+{
+    int *c = (int *) malloc(sizeof(int)*PIGEONS*HOLES*PIGEONS*3);
+    long l = 0;
+    *nc = 0;
+    for(int p = 0; p < PIGEONS; p++) {
+        for(int h = 0; h < HOLES; h++)
+            c[l++] = 1 + p*HOLES + h;
+        c[l++] = 0;
+        (*nc)++;
+    }
+    for(int h = 0; h < HOLES; h++) {
+        for(int p = 0; p < PIGEONS; p++) {
+            for(int q = p + 1; q < PIGEONS; q++) {
+                c[l++] = -(1 + p*HOLES + h);
+                c[l++] = -(1 + q*HOLES + h);
+                c[l++] = 0;
+                (*nc)++;
+            }
+        }
+    }
+    return c;
+}
+
+typedef struct
+{
+    long count;
+    long sum;   /* A checksum of the cubes in order. */
+} tally_t;
+
+static void tally_add(tally_t *t, int d, const int *cube, int aut)
+{
+    t->count++;
+    for(int i = 0; i < d; i++)
+        t->sum = 31*t->sum + cube[i];
+    t->sum = 31*t->sum + aut;
+}
+
+static int tally_cube(void *ctx, int d, const int *cube, int aut)
+{
+    tally_add((tally_t *) ctx, d, cube, aut);
+    return 0;
+}
+
+static reducer_t *pigeonhole_reducer(const int *clauses, long nc)
+{
+    reducer_t *r = reducer_alloc_cnf(PIGEONS*HOLES, nc, clauses, 0);
+    reducer_set_length(r, 6);
+    reducer_set_threshold(r, 1);
+    return r;
+}
+
+int main(void)
+{
+    log_set_level(LOG_QUIET);
+    long g = graphs();
+    printf("graphs on %d points: %ld\n", POINTS, g);
+
+    long nc;
+    int *clauses = pigeonhole(&nc);
+
+    tally_t pull = { 0, 0 };
+    reducer_t *r = pigeonhole_reducer(clauses, nc);
+    int *cube = (int *) malloc(sizeof(int)*reducer_cube_capacity(r));
+    int d, aut;
+    while(reducer_next_cube(r, &d, cube, &aut)) {
+        for(int i = 0; i < d; i++)
+            if(cube[i] == 0 || abs(cube[i]) > PIGEONS*HOLES)
+                return 1;
+        tally_add(&pull, d, cube, aut);
+    }
+    /* The iterator stays at the end once it gets there. */
+    int again = reducer_next_cube(r, &d, cube, &aut);
+    free(cube);
+    reducer_free(r);
+
+    tally_t push = { 0, 0 };
+    r = pigeonhole_reducer(clauses, nc);
+    long count = reducer_for_each_cube(r, tally_cube, &push);
+    reducer_free(r);
+    free(clauses);
+
+    printf("pigeonhole cubes: %ld (pull), %ld (callback)\n", 
+           pull.count, push.count);
+    graph_cache_free();
+    return g == 34 && 
+           pull.count > 0 && 
+           pull.count == count &&
+           pull.count == push.count && 
+           pull.sum == push.sum &&
+           !again ? 0 : 1;
+}
@@ -59,6 +59,10 @@ struct graph_struct
     int *       lab;
     int *       ptn;
     int *       orb_cells;
+    int *       orb_cell_start;
+    int *       orb_cell_of;
+    int         num_orb_cells;
+    int         have_cells;
     int         num_gen;
     int         idx_gen;
     int **      aut_gen;
@@ -66,6 +70,8 @@ struct graph_struct
     int *       stab_seq;
     int         aut_idx_size;
     int         have_can;
+    int         decompose;
+    int         twins;
 };
 
 /************************************* Initialization and release functions. */
@@ -85,8 +91,12 @@ static void graph_init(graph_t *g, int order, long edgebuf_size)
     g->ptn          = (int *) MALLOC(sizeof(int)*order);
     g->orb          = (int *) MALLOC(sizeof(int)*order);
     g->orb_cells    = NULL;
-    g->aut_idx      = (int *) MALLOC(sizeof(int)*(order+1));
-    g->stab_seq     = (int *) MALLOC(sizeof(int)*(order+1));
+    g->orb_cell_start = NULL;
+    g->orb_cell_of  = NULL;
+    g->num_orb_cells = 0;
+    g->have_cells   = 0;
+    g->aut_idx      = (int *) MALLOC(sizeof(int)*(2*order+1));
+    g->stab_seq     = (int *) MALLOC(sizeof(int)*(2*order+1));
     g->aut_idx_size = 0;
     g->num_gen      = 0;
     g->idx_gen      = 0;
@@ -102,6 +112,8 @@ static void graph_init(graph_t *g, int order, long edgebuf_size)
     g->ptn[order-1] = 0;
     
     g->have_can = 0;
+    g->decompose = 0;
+    g->twins = 0;
 }
 
 static void graph_release(graph_t *g)
@@ -112,8 +124,11 @@ static void graph_release(graph_t *g)
     FREE(g->aut_gen);
     FREE(g->stab_seq);
     FREE(g->aut_idx);
-    if(g->orb_cells != NULL)
+    if(g->orb_cells != NULL) {
         FREE(g->orb_cells);
+        FREE(g->orb_cell_start);
+        FREE(g->orb_cell_of);
+    }
     FREE(g->orb);
     FREE(g->ptn);
     FREE(g->lab);
@@ -231,6 +246,8 @@ graph_t *graph_relabel(graph_t *g, int *p)
         r->ptn[i] = g->ptn[i];
     }   
     r->num_edges = g->num_edges;
+    r->decompose = g->decompose;
+    r->twins = g->twins;
     long *t = r->edgebuf;
     long *s = g->edgebuf;
     for(long i = 0; i < g->num_edges; i++)
@@ -256,6 +273,34 @@ graph_t *graph_dup(graph_t *g)
     return graph_relabel(g, pid);
 }
 
+/* Copies s into t (of the same order), reusing the buffers of t. */
+
+void graph_copy(graph_t *t, graph_t *s)
+{
+    if(t->order != s->order)
+        ABORT("order mismatch (%d vs %d)", t->order, s->order);
+    if(t->edgebuf_size < s->num_edges) {
+        FREE(t->can_edgebuf);
+        FREE(t->edgebuf);
+        t->edgebuf_size = s->edgebuf_size;
+        t->edgebuf      = (long *) MALLOC(sizeof(long)*t->edgebuf_size);
+        t->can_edgebuf  = (long *) MALLOC(sizeof(long)*t->edgebuf_size);
+    }
+    for(int i = 0; i < s->order; i++) {
+        t->lab[i] = s->lab[i];
+        t->ptn[i] = s->ptn[i];
+    }
+    long *tb = t->edgebuf;
+    long *sb = s->edgebuf;
+    for(long i = 0; i < s->num_edges; i++)
+        tb[i] = sb[i];
+    t->num_edges         = s->num_edges;
+    t->edgebuf_is_sorted = s->edgebuf_is_sorted;
+    t->decompose         = s->decompose;
+    t->twins             = s->twins;
+    t->have_can          = 0;
+}
+
 /************************************************************** Add an edge. */
 
 void graph_add_edge(graph_t *g, int i, int j)
@@ -283,6 +328,16 @@ long graph_num_edges(graph_t *g)
     return g->num_edges;
 }
 
+/************************************* Returns the end vertices of an edge. */
+
+void graph_edge(graph_t *g, long e, int *i, int *j)
+{
+    if(e < 0 || e >= g->num_edges)
+        ABORT("bad edge index (e = %ld)", e);
+    *i = edge_i(g->edgebuf[e]);
+    *j = edge_j(g->edgebuf[e]);
+}
+
 /****************************************************** Compares two graphs. */
 
 static int graph_compare(graph_t *a, graph_t *b)
@@ -431,7 +486,7 @@ int *graph_ptn(graph_t *g)
 
 /*********************** Computes canonical labeling for a graph (internal). */
 
-graph_t *autom_g;
+THREAD_LOCAL graph_t *autom_g;
 
 static void lvlproc(int *lab, int *ptn, int lvl, int *orb, statsblk *stats,
                     int tv, int idx, int tcellsize, int numcells,
@@ -453,24 +508,71 @@ static void automproc(int numgen, int *p, int *orb,
     g->num_gen++;
 }
 
-static void graph_getcan(graph_t *g)
-{
-    if(g->have_can)
-        return;
+/* Graphs of order at most GRAPH_SMALL_MAXN are labeled with dense nauty,
+ * with the adjacency rows (at most GRAPH_SMALL_WORDS setwords each) 
+ * on the stack so that no allocation takes place. */
 
-    push_time();
+#define GRAPH_SMALL_MAXN  128
+#define GRAPH_SMALL_WORDS SETWORDSNEEDED(GRAPH_SMALL_MAXN)
 
+static void graph_getcan_dense(graph_t *g)
+{
     int  n = g->order;
     long m = g->num_edges;
 
-    g->num_gen      = 0;
-    g->idx_gen      = 0;
-    g->aut_idx_size = 0;
+    graph ng[GRAPH_SMALL_MAXN*GRAPH_SMALL_WORDS];
+    graph ncg[GRAPH_SMALL_MAXN*GRAPH_SMALL_WORDS];
+    static THREAD_LOCAL DEFAULTOPTIONS_GRAPH(options);
+    statsblk stats;
+
+    int mm = SETWORDSNEEDED(n);
+    if(n > GRAPH_SMALL_MAXN)
+        ABORT("graph too large for dense path (n = %d)", n);
+    nauty_check(WORDSIZE, mm, n, NAUTYVERSIONID);
+
+    EMPTYGRAPH(ng, mm, n);
+    long *buf = g->edgebuf;
+    for(long l = 0; l < m; l++) {
+        long b = buf[l];
+        ADDONEEDGE(ng, edge_i(b), edge_j(b), mm);
+    }
+
+    options.defaultptn    = 0;
+    options.getcanon      = 1;
+    options.userautomproc = &automproc;
+    options.userlevelproc = &lvlproc;
+
+    densenauty(ng, g->lab, g->ptn, g->orb, &options, &stats, mm, n, ncg);
+
+    /* Read off the canonical edges j > i, row by row and word by word. */
+    long l = 0;
+    long *cbuf = g->can_edgebuf;
+    for(int i = 0; i < n; i++) {
+        set *row = GRAPHROW(ncg, i, mm);
+        for(int w = SETWD(i); w < mm; w++) {
+            setword x = row[w];
+            if(w == SETWD(i))
+                x &= BITMASK(SETBT(i));
+            while(x != 0) {
+                int b = FIRSTBITNZ(x);
+                x ^= bit[b];
+                cbuf[l++] = edge_make(i, TIMESWORDSIZE(w) + b);
+            }
+        }
+    }
+    if(l != m)
+        ABORT("bad canonical form (l = %ld, m = %ld)", l, m);
+}
+
+static void graph_getcan_sparse(graph_t *g)
+{
+    int  n = g->order;
+    long m = g->num_edges;
 
     sparsegraph ng, ncg;
     SG_INIT(ng);
     SG_INIT(ncg);
-    static DEFAULTOPTIONS_SPARSEGRAPH(options);
+    static THREAD_LOCAL DEFAULTOPTIONS_SPARSEGRAPH(options);
     statsblk stats;
 
     int mm = SETWORDSNEEDED(n);
@@ -533,9 +635,6 @@ static void graph_getcan(graph_t *g)
     options.userautomproc = &automproc;
     options.userlevelproc = &lvlproc;
 
-    autom_g = g;
-    g->num_gen = 0;
-
     sparsenauty(&ng, g->lab, g->ptn, g->orb, &options, &stats, &ncg);
 
     long l = 0;
@@ -562,15 +661,906 @@ static void graph_getcan(graph_t *g)
     FREE(e);
     FREE(d);
     FREE(v);
+}
+
+/* Runs nauty on the whole graph. */
+
+static void graph_getcan_plain(graph_t *g)
+{
+    g->num_gen      = 0;
+    g->idx_gen      = 0;
+    g->aut_idx_size = 0;
+
+    autom_g = g;
+
+    if(g->order <= GRAPH_SMALL_MAXN)
+        graph_getcan_dense(g);
+    else
+        graph_getcan_sparse(g);
 
     g->aut_idx[g->aut_idx_size] = 0;
     g->stab_seq[g->aut_idx_size] = -1;
+}
 
-    pop_print_time("nauty");
+/*************************************** Labeling by connected components. */
+
+/*
+ * With decomposition enabled, the vertices in singleton color cells are
+ * set aside; every automorphism fixes them. What remains splits into
+ * connected components. Each component is labeled by nauty together with
+ * its fixed neighbours, which keep their global cells. The automorphism
+ * group is then the product over classes of isomorphic components of the
+ * wreath products of a component group with the symmetric group on the
+ * copies. The component labelings are cached under the structure of the
+ * component in local numbering, so a component that recurs unchanged, in
+ * the same graph or in the next one, is passed to nauty only once.
+ */
+
+#define COMP_CACHE_SIZE 1024
+
+struct comp_struct
+{
+    long        stamp;     /* Last labeling that used the entry. */
+    int         key_len;
+    int *       key;       /* Structure in local numbering. */
+    int         ckey_len;
+    int *       ckey;      /* Canonical form. */
+    int         order;     /* Component plus fixed neighbours. */
+    int *       lab;       /* Canonical labeling. */
+    int *       orb;       /* Orbit minima. */
+    int         num_gen;
+    int *       gen;       /* Generators, 'order' entries each. */
+    int         idx_len;
+    int *       idx;       /* Orbit lengths along the stabilizer chain. */
+    int *       seq;       /* Fixed vertices along the stabilizer chain. */
+};
+
+typedef struct comp_struct comp_t;
+
+/* Each thread labels with a cache of its own. */
+
+static THREAD_LOCAL comp_t **comp_cache = NULL;
+static THREAD_LOCAL long     comp_stamp = 0;
+
+static void comp_free(comp_t *e)
+{
+    FREE(e->seq);
+    FREE(e->idx);
+    if(e->num_gen > 0)
+        FREE(e->gen);
+    FREE(e->orb);
+    FREE(e->lab);
+    FREE(e->ckey);
+    FREE(e->key);
+    FREE(e);
+}
+
+/* Releases the component cache of the calling thread. */
+
+void graph_cache_free(void)
+{
+    if(comp_cache == NULL)
+        return;
+    for(int i = 0; i < COMP_CACHE_SIZE; i++)
+        if(comp_cache[i] != NULL)
+            comp_free(comp_cache[i]);
+    FREE(comp_cache);
+    comp_cache = NULL;
+}
+
+static unsigned long comp_hash(int l, const int *a)
+{
+    unsigned long h = 14695981039346656037UL;
+    for(int i = 0; i < l; i++) {
+        h ^= (unsigned int) a[i];
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+/* Labels the local graph given by 'key' with nauty. The key lists the
+ * component order c, the number f of fixed neighbours, the global cell 
+ * of each of the c+f local vertices, the number of edges, and the edges. */
+
+static comp_t *comp_label(int key_len, const int *key)
+{
+    int c  = key[0];
+    int f  = key[1];
+    int nl = c + f;
+    const int *cell = key + 2;
+    int ml = key[2 + nl];
+    const int *e = key + 3 + nl;
+
+    graph_t *h = graph_alloc(nl);
+    for(int l = 0; l < ml; l++)
+        graph_add_edge(h, e[2*l], e[2*l+1]);
+    heapsort_int_indirect(nl, cell, h->lab);
+    for(int i = 0; i < nl; i++)
+        if(i == nl-1 || cell[h->lab[i]] != cell[h->lab[i+1]])
+            h->ptn[i] = 0;
+        else
+            h->ptn[i] = 1;
+    graph_getcan_plain(h);
+
+    comp_t *x = (comp_t *) MALLOC(sizeof(comp_t));
+    x->stamp   = comp_stamp;
+    x->key_len = key_len;
+    x->key     = (int *) MALLOC(sizeof(int)*key_len);
+    for(int i = 0; i < key_len; i++)
+        x->key[i] = key[i];
+    x->order   = nl;
+    x->lab     = (int *) MALLOC(sizeof(int)*nl);
+    x->orb     = (int *) MALLOC(sizeof(int)*nl);
+    for(int i = 0; i < nl; i++) {
+        x->lab[i] = h->lab[i];
+        x->orb[i] = h->orb[i];
+    }
+    x->num_gen = h->num_gen;
+    if(x->num_gen > 0)
+        x->gen = (int *) MALLOC(sizeof(int)*nl*x->num_gen);
+    for(int j = 0; j < x->num_gen; j++)
+        for(int i = 0; i < nl; i++)
+            x->gen[j*nl + i] = h->aut_gen[j][i];
+    x->idx_len = h->aut_idx_size;
+    x->idx     = (int *) MALLOC(sizeof(int)*(x->idx_len+1));
+    x->seq     = (int *) MALLOC(sizeof(int)*(x->idx_len+1));
+    for(int i = 0; i < x->idx_len; i++) {
+        x->idx[i] = h->aut_idx[i];
+        x->seq[i] = h->stab_seq[i];
+    }
+
+    /* The canonical form lists the cells by canonical position and 
+     * then the canonical edges in sorted order. */
+    x->ckey_len = 3 + nl + 2*ml;
+    x->ckey     = (int *) MALLOC(sizeof(int)*x->ckey_len);
+    x->ckey[0] = c;
+    x->ckey[1] = f;
+    for(int i = 0; i < nl; i++)
+        x->ckey[2 + i] = cell[h->lab[i]];
+    x->ckey[2 + nl] = ml;
+    for(int l = 0; l < ml; l++) {
+        x->ckey[3 + nl + 2*l]     = edge_i(h->can_edgebuf[l]);
+        x->ckey[3 + nl + 2*l + 1] = edge_j(h->can_edgebuf[l]);
+    }
+    graph_free(h);
+    return x;
+}
+
+/* Looks up a component in the cache, labeling it on a miss. An entry in 
+ * use by the current labeling is never evicted; a colliding component is
+ * then returned without caching and flagged for release in 'own'. */
+
+static comp_t *comp_get(int key_len, const int *key, int *own)
+{
+    if(comp_cache == NULL) {
+        comp_cache = (comp_t **) MALLOC(sizeof(comp_t *)*COMP_CACHE_SIZE);
+        for(int i = 0; i < COMP_CACHE_SIZE; i++)
+            comp_cache[i] = NULL;
+    }
+    int s = (int) (comp_hash(key_len, key) % COMP_CACHE_SIZE);
+    comp_t *x = comp_cache[s];
+    *own = 0;
+    if(x != NULL && x->key_len == key_len &&
+       !memcmp(x->key, key, sizeof(int)*key_len)) {
+        x->stamp = comp_stamp;
+        return x;
+    }
+    comp_t *y = comp_label(key_len, key);
+    if(x != NULL && x->stamp == comp_stamp) {
+        *own = 1;
+        return y;
+    }
+    if(x != NULL)
+        comp_free(x);
+    comp_cache[s] = y;
+    return y;
+}
+
+static int comp_compare(const comp_t *a, const comp_t *b)
+{
+    if(a->ckey_len != b->ckey_len)
+        return a->ckey_len < b->ckey_len ? -1 : 1;
+    for(int i = 0; i < a->ckey_len; i++)
+        if(a->ckey[i] != b->ckey[i])
+            return a->ckey[i] < b->ckey[i] ? -1 : 1;
+    return 0;
+}
+
+typedef struct
+{
+    comp_t *    e;
+    int *       v;         /* Component vertices, then fixed neighbours. */
+    int         own;
+} comp_ref_t;
+
+static int comp_ref_compare(const void *x, const void *y)
+{
+    const comp_ref_t *a = (const comp_ref_t *) x;
+    const comp_ref_t *b = (const comp_ref_t *) y;
+    int r = comp_compare(a->e, b->e);
+    if(r == 0)
+        r = a->v[0] - b->v[0];
+    return r;
+}
+
+/* Assembles the canonical labeling, orbits, generators and group order 
+ * of g from its components. Returns 0 (and does nothing) if there are 
+ * fewer than two components. */
+
+static int graph_getcan_components(graph_t *g)
+{
+    int  n = g->order;
+    long m = g->num_edges;
+    long *buf = g->edgebuf;
+
+    /* Cells of the coloring. */
+    int *cell  = (int *) MALLOC(sizeof(int)*n);
+    int *cpos  = (int *) MALLOC(sizeof(int)*(n+1));
+    int nc = 0;
+    cpos[0] = 0;
+    for(int i = 0; i < n; i++) {
+        cell[g->lab[i]] = nc;
+        if(g->ptn[i] == 0)
+            cpos[++nc] = i+1;
+    }
+
+    /* Adjacency lists. */
+    int *adj_pos = (int *) MALLOC(sizeof(int)*(n+1));
+    int *adj     = (int *) MALLOC(sizeof(int)*(2*m+1));
+    for(int i = 0; i <= n; i++)
+        adj_pos[i] = 0;
+    for(long l = 0; l < m; l++) {
+        adj_pos[edge_i(buf[l])+1]++;
+        adj_pos[edge_j(buf[l])+1]++;
+    }
+    for(int i = 0; i < n; i++)
+        adj_pos[i+1] += adj_pos[i];
+    for(long l = 0; l < m; l++) {
+        int i = edge_i(buf[l]);
+        int j = edge_j(buf[l]);
+        adj[adj_pos[i]++] = j;
+        adj[adj_pos[j]++] = i;
+    }
+    for(int i = n; i > 0; i--)
+        adj_pos[i] = adj_pos[i-1];
+    adj_pos[0] = 0;
+
+    /* Components of the vertices in nonsingleton cells. */
+    int *comp  = (int *) MALLOC(sizeof(int)*n);
+    int *verts = (int *) MALLOC(sizeof(int)*n);
+    int *vpos  = (int *) MALLOC(sizeof(int)*(n+1));
+    int ncomp = 0;
+    int top = 0;
+    for(int u = 0; u < n; u++)
+        comp[u] = -1;
+    for(int u = 0; u < n; u++) {
+        int c = cell[u];
+        if(comp[u] >= 0 || cpos[c+1] - cpos[c] == 1)
+            continue;
+        vpos[ncomp] = top;
+        comp[u] = ncomp;
+        verts[top++] = u;
+        for(int q = vpos[ncomp]; q < top; q++) {
+            int w = verts[q];
+            for(int a = adj_pos[w]; a < adj_pos[w+1]; a++) {
+                int z = adj[a];
+                int cz = cell[z];
+                if(comp[z] < 0 && cpos[cz+1] - cpos[cz] > 1) {
+                    comp[z] = ncomp;
+                    verts[top++] = z;
+                }
+            }
+        }
+        ncomp++;
+    }
+    vpos[ncomp] = top;
+    if(ncomp < 2) {
+        FREE(vpos);
+        FREE(verts);
+        FREE(comp);
+        FREE(adj);
+        FREE(adj_pos);
+        FREE(cpos);
+        FREE(cell);
+        return 0;
+    }
+
+    /* Label the components. */
+    comp_stamp++;
+    comp_ref_t *ref = (comp_ref_t *) MALLOC(sizeof(comp_ref_t)*ncomp);
+    int *loc  = (int *) MALLOC(sizeof(int)*n);
+    int *key  = (int *) MALLOC(sizeof(int)*(3 + 2*n + 2*m));
+    long *el  = (long *) MALLOC(sizeof(long)*(m+1));
+    for(int u = 0; u < n; u++)
+        loc[u] = -1;
+    for(int k = 0; k < ncomp; k++) {
+        int *v = verts + vpos[k];
+        int c = vpos[k+1] - vpos[k];
+        heapsort_int(c, v);
+        for(int i = 0; i < c; i++)
+            loc[v[i]] = i;
+
+        /* Fixed neighbours, in increasing order. */
+        int f = 0;
+        int *fx = key + 2 + n;
+        for(int i = 0; i < c; i++) {
+            for(int a = adj_pos[v[i]]; a < adj_pos[v[i]+1]; a++) {
+                int z = adj[a];
+                if(comp[z] < 0 && loc[z] < 0) {
+                    loc[z] = 0;
+                    fx[f++] = z;
+                }
+            }
+        }
+        heapsort_int(f, fx);
+        int *rv = (int *) MALLOC(sizeof(int)*(c+f));
+        for(int i = 0; i < c; i++)
+            rv[i] = v[i];
+        for(int j = 0; j < f; j++) {
+            rv[c+j] = fx[j];
+            loc[fx[j]] = c+j;
+        }
+
+        long ml = 0;
+        for(int i = 0; i < c; i++) {
+            for(int a = adj_pos[v[i]]; a < adj_pos[v[i]+1]; a++) {
+                int z = adj[a];
+                if(loc[z] > i)
+                    el[ml++] = (((long) i)<<32) | loc[z];
+            }
+        }
+        heapsort_long(ml, el);
+
+        int nl = c + f;
+        key[0] = c;
+        key[1] = f;
+        for(int i = 0; i < nl; i++)
+            key[2 + i] = cell[rv[i]];
+        key[2 + nl] = (int) ml;
+        for(long l = 0; l < ml; l++) {
+            key[3 + nl + 2*l]     = edge_i(el[l]);
+            key[3 + nl + 2*l + 1] = edge_j(el[l]);
+        }
+        for(int i = 0; i < nl; i++)
+            loc[rv[i]] = -1;
+
+        ref[k].v = rv;
+        ref[k].e = comp_get(3 + nl + 2*ml, key, &ref[k].own);
+    }
+    FREE(el);
+    FREE(key);
+    qsort(ref, ncomp, sizeof(comp_ref_t), comp_ref_compare);
+
+    /* Canonical labeling: cell by cell, the components in sorted order, 
+     * each in its canonical order. Fixed vertices keep their cells. */
+    int *fill = loc;
+    for(int c = 0; c < nc; c++)
+        fill[c] = cpos[c];
+    for(int k = 0; k < ncomp; k++) {
+        comp_t *e = ref[k].e;
+        int c = e->key[0];
+        for(int p = 0; p < e->order; p++) {
+            int lv = e->lab[p];
+            if(lv < c) {
+                int u = ref[k].v[lv];
+                g->lab[fill[cell[u]]++] = u;
+            }
+        }
+    }
+    for(int u = 0; u < n; u++) {
+        if(comp[u] < 0) {
+            g->lab[cpos[cell[u]]] = u;
+            g->orb[u] = u;
+        }
+    }
 
+    /* Orbits, generators and orbit lengths, class by class. */
+    g->num_gen      = 0;
+    g->idx_gen      = 0;
+    g->aut_idx_size = 0;
+    int *porb = comp;
+    int *pmin = verts;
+    for(int k = 0; k < ncomp; ) {
+        int j = k+1;
+        while(j < ncomp && comp_compare(ref[k].e, ref[j].e) == 0)
+            j++;
+        comp_t *e = ref[k].e;
+        int c  = e->key[0];
+        int nl = e->order;
+
+        /* Orbits of canonical positions (by minimum position). */
+        for(int p = 0; p < nl; p++)
+            porb[e->lab[p]] = -1;
+        for(int p = 0; p < nl; p++) {
+            int o = e->orb[e->lab[p]];
+            if(porb[o] < 0)
+                porb[o] = p;
+            pmin[p] = porb[o];
+        }
+        for(int p = 0; p < nl; p++)
+            porb[p] = n;
+        for(int i = k; i < j; i++)
+            for(int p = 0; p < nl; p++)
+                if(ref[i].e->lab[p] < c) {
+                    int u = ref[i].v[ref[i].e->lab[p]];
+                    if(u < porb[pmin[p]])
+                        porb[pmin[p]] = u;
+                }
+        for(int i = k; i < j; i++)
+            for(int p = 0; p < nl; p++)
+                if(ref[i].e->lab[p] < c)
+                    g->orb[ref[i].v[ref[i].e->lab[p]]] = porb[pmin[p]];
+
+        /* Generators of the first copy, and transpositions of copies. */
+        int t = e->num_gen + (j-k-1);
+        if(g->num_gen + t > n)
+            ABORT("too many generators");
+        for(int q = 0; q < t; q++) {
+            if(g->aut_gen[g->num_gen] == NULL)
+                g->aut_gen[g->num_gen] = MALLOC(sizeof(int)*n);
+            int *a = g->aut_gen[g->num_gen++];
+            for(int u = 0; u < n; u++)
+                a[u] = u;
+            if(q < e->num_gen) {
+                const int *b = e->gen + q*nl;
+                for(int i = 0; i < c; i++)
+                    a[ref[k].v[i]] = ref[k].v[b[i]];
+            } else {
+                comp_ref_t *x = ref + k + (q - e->num_gen);
+                comp_ref_t *y = x + 1;
+                for(int p = 0; p < nl; p++) {
+                    if(e->lab[p] < c) {
+                        int u = x->v[x->e->lab[p]];
+                        int w = y->v[y->e->lab[p]];
+                        a[u] = w;
+                        a[w] = u;
+                    }
+                }
+            }
+        }
+
+        /* The group order is |Aut(C)|^(j-k) * (j-k)!. */
+        for(int i = k; i < j; i++) {
+            comp_t *x = ref[i].e;
+            if(g->aut_idx_size + x->idx_len + (j-k) > 2*n)
+                ABORT("too many orbit lengths");
+            for(int l = 0; l < x->idx_len; l++) {
+                int s = x->seq[l];
+                g->stab_seq[g->aut_idx_size] = s >= 0 ? ref[i].v[s] : -1;
+                g->aut_idx[g->aut_idx_size++] = x->idx[l];
+            }
+        }
+        for(int i = k; i < j-1; i++) {
+            g->stab_seq[g->aut_idx_size] = ref[i].v[ref[i].e->lab[0]];
+            g->aut_idx[g->aut_idx_size++] = j-i;
+        }
+        k = j;
+    }
+    g->aut_idx[g->aut_idx_size] = 0;
+    g->stab_seq[g->aut_idx_size] = -1;
+
+    /* Canonical form. */
+    int *pos = cpos;
+    for(int i = 0; i < n; i++)
+        pos[g->lab[i]] = i;
+    for(long l = 0; l < m; l++)
+        g->can_edgebuf[l] = edge_relabel(pos, buf[l]);
+    heapsort_long(m, g->can_edgebuf);
+
+    for(int k = 0; k < ncomp; k++) {
+        if(ref[k].own)
+            comp_free(ref[k].e);
+        FREE(ref[k].v);
+    }
+    FREE(ref);
+    FREE(loc);
+    FREE(vpos);
+    FREE(verts);
+    FREE(comp);
+    FREE(adj);
+    FREE(adj_pos);
+    FREE(cpos);
+    FREE(cell);
+    return 1;
+}
+
+/************************************************ Labeling by twin classes. */
+
+/*
+ * With twin reduction enabled, vertices of the same color with identical
+ * open neighbourhoods (false twins) or identical closed neighbourhoods 
+ * (true twins) are collapsed into one representative, the least vertex 
+ * of the class. The quotient graph colors each representative by its 
+ * cell, the size of its class and the type of twins, and is labeled in 
+ * turn (and possibly reduced again). Every permutation of a twin class is 
+ * an automorphism, so the labeling, orbits and generators of the graph 
+ * are lifted from the quotient by expanding each representative into its
+ * class and adding the transpositions of consecutive class members.
+ */
+
+static void graph_getcan_any(graph_t *g);
+
+typedef struct
+{
+    int         cell;
+    int         size;
+    int         type;
+    int         rep;
+} twin_key_t;
+
+static int twin_key_compare(const void *x, const void *y)
+{
+    const twin_key_t *a = (const twin_key_t *) x;
+    const twin_key_t *b = (const twin_key_t *) y;
+    if(a->cell != b->cell)
+        return a->cell < b->cell ? -1 : 1;
+    if(a->size != b->size)
+        return a->size < b->size ? -1 : 1;
+    if(a->type != b->type)
+        return a->type < b->type ? -1 : 1;
+    return a->rep - b->rep;
+}
+
+typedef struct
+{
+    int           cell;
+    unsigned long hash;
+    int           u;
+} twin_hash_t;
+
+static int twin_hash_compare(const void *x, const void *y)
+{
+    const twin_hash_t *a = (const twin_hash_t *) x;
+    const twin_hash_t *b = (const twin_hash_t *) y;
+    if(a->cell != b->cell)
+        return a->cell < b->cell ? -1 : 1;
+    if(a->hash != b->hash)
+        return a->hash < b->hash ? -1 : 1;
+    return a->u - b->u;
+}
+
+/* Tests whether u and w have the same open (closed = 0) or closed 
+ * (closed = 1) neighbourhoods, given sorted adjacency lists. */
+
+static int twin_test(const int *pos, const int *adj, int u, int w, int closed)
+{
+    int du = pos[u+1] - pos[u];
+    int dw = pos[w+1] - pos[w];
+    if(du != dw)
+        return 0;
+    const int *a = adj + pos[u];
+    const int *b = adj + pos[w];
+    if(!closed) {
+        for(int i = 0; i < du; i++)
+            if(a[i] != b[i])
+                return 0;
+        return 1;
+    }
+    /* Closed neighbourhoods: N(u) - w equals N(w) - u and u ~ w. */
+    int i = 0;
+    int j = 0;
+    int adjacent = 0;
+    while(i < du || j < dw) {
+        if(i < du && a[i] == w) {
+            adjacent = 1;
+            i++;
+            continue;
+        }
+        if(j < dw && b[j] == u) {
+            j++;
+            continue;
+        }
+        if(i == du || j == dw || a[i] != b[j])
+            return 0;
+        i++;
+        j++;
+    }
+    return adjacent;
+}
+
+/* Groups the vertices in 'twin' into classes of false (closed = 0) or 
+ * true (closed = 1) twins, considering only vertices with twin[u] == u
+ * on entry. On exit twin[u] is the least vertex in the class of u. */
+
+static void twin_classes(int n, const int *cell, const int *pos, 
+                         const int *adj, int closed, int *twin,
+                         twin_hash_t *h)
+{
+    int l = 0;
+    for(int u = 0; u < n; u++) {
+        if(twin[u] != u)
+            continue;
+        /* Hash the sorted neighbourhood, with u inserted if closed. */
+        unsigned long x = 14695981039346656037UL;
+        int self = closed;
+        for(int a = pos[u]; a <= pos[u+1]; a++) {
+            int z = a < pos[u+1] ? adj[a] : n;
+            if(self && z > u) {
+                x ^= (unsigned int) u;
+                x *= 1099511628211UL;
+                self = 0;
+            }
+            if(z == n)
+                break;
+            x ^= (unsigned int) z;
+            x *= 1099511628211UL;
+        }
+        h[l].cell = cell[u];
+        h[l].hash = x;
+        h[l].u    = u;
+        l++;
+    }
+    qsort(h, l, sizeof(twin_hash_t), twin_hash_compare);
+    for(int i = 0; i < l; ) {
+        int j = i+1;
+        while(j < l && h[j].cell == h[i].cell && h[j].hash == h[i].hash)
+            j++;
+        /* Assign each vertex of the run to the first matching vertex. */
+        for(int s = i+1; s < j; s++) {
+            int u = h[s].u;
+            for(int t = i; t < s; t++) {
+                int w = h[t].u;
+                if(twin[w] == w && twin_test(pos, adj, w, u, closed)) {
+                    twin[u] = w;
+                    break;
+                }
+            }
+        }
+        i = j;
+    }
+}
+
+/* Labels g via its twin quotient. Returns 0 (and does nothing) if g has
+ * no twins. */
+
+static int graph_getcan_twins(graph_t *g)
+{
+    int  n = g->order;
+    long m = g->num_edges;
+    long *buf = g->edgebuf;
+
+    int *cell = (int *) MALLOC(sizeof(int)*n);
+    int nc = 0;
+    for(int i = 0; i < n; i++) {
+        cell[g->lab[i]] = nc;
+        if(g->ptn[i] == 0)
+            nc++;
+    }
+
+    /* Sorted adjacency lists. */
+    int *pos = (int *) MALLOC(sizeof(int)*(n+1));
+    int *adj = (int *) MALLOC(sizeof(int)*(2*m+1));
+    for(int i = 0; i <= n; i++)
+        pos[i] = 0;
+    for(long l = 0; l < m; l++) {
+        pos[edge_i(buf[l])+1]++;
+        pos[edge_j(buf[l])+1]++;
+    }
+    for(int i = 0; i < n; i++)
+        pos[i+1] += pos[i];
+    for(long l = 0; l < m; l++) {
+        int i = edge_i(buf[l]);
+        int j = edge_j(buf[l]);
+        adj[pos[i]++] = j;
+        adj[pos[j]++] = i;
+    }
+    for(int i = n; i > 0; i--)
+        pos[i] = pos[i-1];
+    pos[0] = 0;
+    for(int i = 0; i < n; i++)
+        heapsort_int(pos[i+1] - pos[i], adj + pos[i]);
+
+    /* False twins first, then true twins among the remaining vertices. */
+    int *twin = (int *) MALLOC(sizeof(int)*n);
+    int *type = (int *) MALLOC(sizeof(int)*n);
+    twin_hash_t *h = (twin_hash_t *) MALLOC(sizeof(twin_hash_t)*n);
+    for(int u = 0; u < n; u++)
+        twin[u] = u;
+    twin_classes(n, cell, pos, adj, 0, twin, h);
+    int *size = type;
+    for(int u = 0; u < n; u++)
+        size[u] = 0;
+    for(int u = 0; u < n; u++)
+        size[twin[u]]++;
+    int *rest = (int *) MALLOC(sizeof(int)*n);
+    for(int u = 0; u < n; u++)
+        rest[u] = (twin[u] == u && size[u] == 1) ? u : -1;
+    twin_classes(n, cell, pos, adj, 1, rest, h);
+    FREE(h);
+    int nq = 0;
+    for(int u = 0; u < n; u++) {
+        if(rest[u] >= 0 && rest[u] != u)
+            twin[u] = rest[u];
+    }
+    for(int u = 0; u < n; u++) {
+        type[u] = 0;
+        if(twin[u] == u)
+            nq++;
+    }
+    for(int u = 0; u < n; u++)
+        if(rest[u] >= 0 && rest[u] != u)
+            type[rest[u]] = 1;
+    FREE(rest);
+    if(nq == n) {
+        FREE(type);
+        FREE(twin);
+        FREE(adj);
+        FREE(pos);
+        FREE(cell);
+        return 0;
+    }
+
+    /* Classes as lists of members, in increasing order. */
+    int *cnt  = (int *) MALLOC(sizeof(int)*(n+1));
+    int *mem  = (int *) MALLOC(sizeof(int)*n);
+    for(int u = 0; u <= n; u++)
+        cnt[u] = 0;
+    for(int u = 0; u < n; u++)
+        cnt[twin[u]+1]++;
+    for(int u = 0; u < n; u++)
+        cnt[u+1] += cnt[u];
+    for(int u = 0; u < n; u++)
+        mem[cnt[twin[u]]++] = u;
+    for(int u = n; u > 0; u--)
+        cnt[u] = cnt[u-1];
+    cnt[0] = 0;
+
+    /* The quotient, with the representatives numbered in increasing order
+     * and colored by cell, class size and type of twins. */
+    int *qid  = (int *) MALLOC(sizeof(int)*n);
+    int *qrep = (int *) MALLOC(sizeof(int)*nq);
+    int k = 0;
+    for(int u = 0; u < n; u++) {
+        if(twin[u] == u) {
+            qid[u] = k;
+            qrep[k++] = u;
+        }
+    }
+    graph_t *q = graph_alloc(nq);
+    q->decompose = g->decompose;
+    q->twins     = g->twins;
+    for(long l = 0; l < m; l++) {
+        int i = edge_i(buf[l]);
+        int j = edge_j(buf[l]);
+        if(twin[i] == i && twin[j] == j)
+            graph_add_edge(q, qid[i], qid[j]);
+    }
+    twin_key_t *key = (twin_key_t *) MALLOC(sizeof(twin_key_t)*nq);
+    for(int i = 0; i < nq; i++) {
+        int u = qrep[i];
+        key[i].cell = cell[u];
+        key[i].size = cnt[u+1] - cnt[u];
+        key[i].type = type[u];
+        key[i].rep  = i;
+    }
+    qsort(key, nq, sizeof(twin_key_t), twin_key_compare);
+    for(int i = 0; i < nq; i++) {
+        q->lab[i] = key[i].rep;
+        q->ptn[i] = (i < nq-1 &&
+                     key[i].cell == key[i+1].cell &&
+                     key[i].size == key[i+1].size &&
+                     key[i].type == key[i+1].type) ? 1 : 0;
+    }
+    FREE(key);
+    graph_getcan_any(q);
+
+    /* Lift the canonical labeling and the orbits. */
+    int l = 0;
+    for(int i = 0; i < nq; i++) {
+        int u = qrep[q->lab[i]];
+        for(int s = cnt[u]; s < cnt[u+1]; s++)
+            g->lab[l++] = mem[s];
+    }
+    for(int u = 0; u < n; u++)
+        g->orb[u] = qrep[q->orb[qid[twin[u]]]];
+
+    /* Lift the generators, and add the transpositions in each class. */
+    g->num_gen      = 0;
+    g->idx_gen      = 0;
+    g->aut_idx_size = 0;
+    for(int j = 0; j < q->num_gen + (n - nq); j++) {
+        if(g->aut_gen[j] == NULL)
+            g->aut_gen[j] = MALLOC(sizeof(int)*n);
+        for(int u = 0; u < n; u++)
+            g->aut_gen[j][u] = u;
+    }
+    for(int j = 0; j < q->num_gen; j++) {
+        const int *p = q->aut_gen[j];
+        int *a = g->aut_gen[g->num_gen++];
+        for(int i = 0; i < nq; i++) {
+            int u = qrep[i];
+            int w = qrep[p[i]];
+            for(int s = 0; s < cnt[u+1] - cnt[u]; s++)
+                a[mem[cnt[u] + s]] = mem[cnt[w] + s];
+        }
+    }
+    for(int i = 0; i < nq; i++) {
+        int u = qrep[i];
+        for(int s = cnt[u]; s + 1 < cnt[u+1]; s++) {
+            int *a = g->aut_gen[g->num_gen++];
+            a[mem[s]]   = mem[s+1];
+            a[mem[s+1]] = mem[s];
+        }
+    }
+
+    /* The group order is |Aut(Q)| times the product of the class 
+     * size factorials. */
+    for(int i = 0; i < q->aut_idx_size; i++) {
+        int s = q->stab_seq[i];
+        g->stab_seq[g->aut_idx_size] = s >= 0 ? qrep[s] : -1;
+        g->aut_idx[g->aut_idx_size++] = q->aut_idx[i];
+    }
+    for(int i = 0; i < nq; i++) {
+        int u = qrep[i];
+        for(int s = cnt[u]; s + 1 < cnt[u+1]; s++) {
+            if(g->aut_idx_size >= 2*n)
+                ABORT("too many orbit lengths");
+            g->stab_seq[g->aut_idx_size] = mem[s];
+            g->aut_idx[g->aut_idx_size++] = cnt[u+1] - s;
+        }
+    }
+    g->aut_idx[g->aut_idx_size] = 0;
+    g->stab_seq[g->aut_idx_size] = -1;
+
+    /* Canonical form. */
+    int *inv = pos;
+    for(int i = 0; i < n; i++)
+        inv[g->lab[i]] = i;
+    for(long e = 0; e < m; e++)
+        g->can_edgebuf[e] = edge_relabel(inv, buf[e]);
+    heapsort_long(m, g->can_edgebuf);
+
+    graph_free(q);
+    FREE(qrep);
+    FREE(qid);
+    FREE(mem);
+    FREE(cnt);
+    FREE(type);
+    FREE(twin);
+    FREE(adj);
+    FREE(pos);
+    FREE(cell);
+    return 1;
+}
+
+/* Computes the canonical labeling with the enabled reductions. */
+
+static void graph_getcan_any(graph_t *g)
+{
+    g->have_cells = 0;
+    if(g->twins && graph_getcan_twins(g))
+        ;
+    else if(!g->decompose || !graph_getcan_components(g))
+        graph_getcan_plain(g);
     g->have_can = 1;
 }
 
+static void graph_getcan(graph_t *g)
+{
+    if(g->have_can)
+        return;
+
+    push_time();
+    graph_getcan_any(g);
+    pop_print_time("nauty");
+}
+
+/* Enables (or disables) labeling by connected components. */
+
+void graph_set_decompose(graph_t *g, int on)
+{
+    g->decompose = on;
+    g->have_can = 0;
+}
+
+/* Enables (or disables) labeling by twin classes. */
+
+void graph_set_twins(graph_t *g, int on)
+{
+    g->twins = on;
+    g->have_can = 0;
+}
+
 /********************************** Computes canonical labeling for a graph. */
 
 const int *graph_can_lab(graph_t *g)
@@ -652,29 +1642,84 @@ int graph_same_orbit(graph_t *g, int i, int j)
         return 0;
 }
 
-/**************************************************** Build the orbit cells. */
+/************************************************* Build the orbit partition. */
 
-const int *graph_orbit_cells(graph_t *g)
+/* 
+ * The orbit partition lists the vertices cell by cell, with the cells
+ * in increasing order of their minimum vertex and the vertices in 
+ * increasing order within each cell. Cell c occupies the positions
+ * start[c], start[c]+1, ..., start[c+1]-1; its minimum (the 
+ * representative used by nauty) is at position start[c].
+ * The partition is built in linear time from the orbit array, where
+ * each vertex points to the minimum vertex in its orbit, and cached 
+ * until the graph changes. 
+ */
+
+static void graph_build_cells(graph_t *g)
 {
     graph_getcan(g);
+    if(g->have_cells)
+        return;
     int n = g->order;
-    int *p = g->orb_cells;
-    if(p == NULL)
-        p = (int *) MALLOC(sizeof(int)*n);
-    g->orb_cells = p;
-    for(int i = 0; i < n; i++)
-        p[i] = i;
-    heapsort_int_indirect(n, g->orb, p);
-    int last = 0;
-    while(last < n) {
-        int i = last + 1;
-        for(; i < n; i++)
-            if(g->orb[p[i-1]] != g->orb[p[i]])
-                break;
-        heapsort_int(i - last, p + last);
-        last = i;
+    if(g->orb_cells == NULL) {
+        g->orb_cells      = (int *) MALLOC(sizeof(int)*n);
+        g->orb_cell_start = (int *) MALLOC(sizeof(int)*(n+1));
+        g->orb_cell_of    = (int *) MALLOC(sizeof(int)*n);
+    }
+    const int *orb = g->orb;
+    int *p     = g->orb_cells;
+    int *start = g->orb_cell_start;
+    int *of    = g->orb_cell_of;
+    int nc = 0;
+    for(int i = 0; i < n; i++) {
+        if(orb[i] == i) {
+            of[i] = nc;
+            start[nc++] = 0;
+        } else {
+            if(orb[i] > i || orb[orb[i]] != orb[i])
+                ABORT("orbit array does not point to orbit minima");
+            of[i] = of[orb[i]];
+        }
+        start[of[i]]++;
+    }
+    int sum = 0;
+    for(int c = 0; c < nc; c++) {
+        int t = start[c];
+        start[c] = sum;
+        sum += t;
     }
-    return p;
+    start[nc] = n;
+    for(int i = 0; i < n; i++)
+        p[start[of[i]]++] = i;
+    for(int c = nc; c > 0; c--)
+        start[c] = start[c-1];
+    start[0] = 0;
+    g->num_orb_cells = nc;
+    g->have_cells = 1;
+}
+
+const int *graph_orbit_cells(graph_t *g)
+{
+    graph_build_cells(g);
+    return g->orb_cells;
+}
+
+int graph_orbit_ncells(graph_t *g)
+{
+    graph_build_cells(g);
+    return g->num_orb_cells;
+}
+
+const int *graph_orbit_starts(graph_t *g)
+{
+    graph_build_cells(g);
+    return g->orb_cell_start;
+}
+
+const int *graph_orbit_cell_of(graph_t *g)
+{
+    graph_build_cells(g);
+    return g->orb_cell_of;
 }
 
 /**************************************************** A simple graph parser. */
@@ -743,10 +1788,11 @@ void graph_print(FILE *out, graph_t *g)
 
 void graph_print_orbits(FILE *out, graph_t *g, int l, int *m)
 {
-    graph_getcan(g);
+    graph_build_cells(g);
     int n = g->order;
-    const int *p = graph_orbit_cells(g);
-    const int *c = graph_orbits(g);
+    int nc = g->num_orb_cells;
+    const int *p = g->orb_cells;
+    const int *start = g->orb_cell_start;
     int *q = (int *) MALLOC(sizeof(int)*n);
     for(int i = 0; i < n; i++)
         q[i] = 0;
@@ -756,10 +1802,9 @@ void graph_print_orbits(FILE *out, graph_t *g, int l, int *m)
         q[m[i]] = 1;
     }
     int have_previous = 0;
-    for(int s = 0; s < n; s++) {
-        int u = s+1;
-        for(; u < n && c[p[s]] == c[p[u]]; u++)
-            ;
+    for(int c = 0; c < nc; c++) {
+        int s = start[c];
+        int u = start[c+1];
         for(int j = s+1; j < u; j++)
             if(q[p[s]] != q[p[j]])
                 ABORT("bad m array -- not a union of orbits");
@@ -768,7 +1813,6 @@ void graph_print_orbits(FILE *out, graph_t *g, int l, int *m)
             print_int_array(out, u-s, p + s);
             have_previous = 1;
         }
-        s = u-1;
     }
     FREE(q);
 }
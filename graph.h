@@ -54,10 +54,12 @@ void            graph_free           (graph_t *g);
 void            graph_empty          (graph_t *g);
 void            graph_add_edge       (graph_t *g, int i, int j);
 graph_t *       graph_dup            (graph_t *g);
+void            graph_copy           (graph_t *t, graph_t *s);
 graph_t *       graph_relabel        (graph_t *g, int *p);
 graph_t *       graph_relabel_inv    (graph_t *g, int *p);
 int             graph_order          (graph_t *g);
 long            graph_num_edges      (graph_t *g);
+void            graph_edge           (graph_t *g, long e, int *i, int *j);
 
 int *           graph_lab            (graph_t *g);
 int *           graph_ptn            (graph_t *g);
@@ -70,6 +72,12 @@ const int *     graph_aut_gen        (graph_t *g);
 const int *     graph_orbits         (graph_t *g);
 int             graph_same_orbit     (graph_t *g, int i, int j);
 const int *     graph_orbit_cells    (graph_t *g);
+int             graph_orbit_ncells   (graph_t *g);
+const int *     graph_orbit_starts   (graph_t *g);
+const int *     graph_orbit_cell_of  (graph_t *g);
+void            graph_set_decompose  (graph_t *g, int on);
+void            graph_set_twins      (graph_t *g, int on);
+void            graph_cache_free     (void);
 
 graph_t *       graph_parse          (FILE *in);
 void            graph_print          (FILE *out, graph_t *g);
@@ -0,0 +1,62 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/*********************************************** Incremental SAT solver API. */
+
+#ifndef IPASIR_READ
+#define IPASIR_READ
+
+/* The IPASIR interface of incremental SAT solvers. A solver library that
+ * implements it is linked in with HAVE_IPASIR (cf. 'Makefile'). 
+ * ipasir_solve() returns 10 (satisfiable), 20 (unsatisfiable), or 
+ * 0 (interrupted); the assumptions hold for the next call only. */
+
+const char *  ipasir_signature        (void);
+void *        ipasir_init             (void);
+void          ipasir_release          (void *solver);
+void          ipasir_add              (void *solver, int lit_or_zero);
+void          ipasir_assume           (void *solver, int lit);
+int           ipasir_solve            (void *solver);
+int           ipasir_val              (void *solver, int lit);
+int           ipasir_failed           (void *solver, int lit);
+void          ipasir_set_terminate    (void *solver, void *data, 
+                                       int (*terminate)(void *data));
+void          ipasir_set_learn        (void *solver, void *data, 
+                                       int max_length, 
+                                       void (*learn)(void *data, 
+                                                     int *clause));
+
+#endif
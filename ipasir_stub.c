@@ -0,0 +1,268 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/************************************** A minimal solver for the IPASIR API. */
+
+/* A plain DPLL solver behind the IPASIR interface, small enough to test
+ * the in-process solving (-A) without an external solver library. It
+ * keeps the clauses in one array of zero-terminated literals, and solves
+ * by unit propagation and branching on the first unassigned variable. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "common.h"
+#include "ipasir.h"
+
+typedef struct stub_struct
+{
+    int  *lits;     /* The clauses, each terminated by a zero. */
+    long  n;
+    long  cap;
+    int  *assume;   /* The assumptions for the next solve. */
+    int   na;
+    int   acap;
+    int   nv;
+    int  *val;      /* Value of each variable: 1, -1 or 0 (unassigned). */
+    int  *trail;    /* Assigned variables in assignment order. */
+    int   nt;
+} stub_t;
+
+static void stub_var(stub_t *s, int l)
+{
+    int x = abs(l);
+    if(x > s->nv) {
+        int *v = (int *) MALLOC(sizeof(int)*(x+1));
+        int *t = (int *) MALLOC(sizeof(int)*(x+1));
+        for(int i = 0; i <= x; i++)
+            v[i] = i <= s->nv ? s->val[i] : 0;
+        for(int i = 0; i < s->nt; i++)
+            t[i] = s->trail[i];
+        FREE(s->val);
+        FREE(s->trail);
+        s->val = v;
+        s->trail = t;
+        s->nv = x;
+    }
+}
+
+static int stub_lit(stub_t *s, int l)
+{
+    return l > 0 ? s->val[l] : -s->val[-l];
+}
+
+static void stub_set(stub_t *s, int l)
+{
+    s->val[abs(l)] = l > 0 ? 1 : -1;
+    s->trail[s->nt++] = abs(l);
+}
+
+static void stub_undo(stub_t *s, int nt)
+{
+    while(s->nt > nt)
+        s->val[s->trail[--s->nt]] = 0;
+}
+
+/* Propagates the unit clauses, returns 0 on a conflict. */
+
+static int stub_propagate(stub_t *s)
+{
+    int changed = 1;
+    while(changed) {
+        changed = 0;
+        for(long i = 0; i < s->n; i++) {
+            int sat = 0, free_count = 0, unit = 0;
+            for(; s->lits[i] != 0; i++) {
+                int v = stub_lit(s, s->lits[i]);
+                if(v > 0)
+                    sat = 1;
+                else if(v == 0) {
+                    free_count++;
+                    unit = s->lits[i];
+                }
+            }
+            if(sat)
+                continue;
+            if(free_count == 0)
+                return 0;
+            if(free_count == 1) {
+                stub_set(s, unit);
+                changed = 1;
+            }
+        }
+    }
+    return 1;
+}
+
+static int stub_dpll(stub_t *s)
+{
+    int nt = s->nt;
+    if(!stub_propagate(s)) {
+        stub_undo(s, nt);
+        return 0;
+    }
+    int x = 1;
+    while(x <= s->nv && s->val[x] != 0)
+        x++;
+    if(x > s->nv)
+        return 1;
+    for(int l = x; l != 0; l = l > 0 ? -x : 0) {
+        int mt = s->nt;
+        stub_set(s, l);
+        if(stub_dpll(s))
+            return 1;
+        stub_undo(s, mt);
+    }
+    stub_undo(s, nt);
+    return 0;
+}
+
+const char *ipasir_signature(void)
+{
+    return "ipasir_stub (DPLL)";
+}
+
+void *ipasir_init(void)
+{
+    stub_t *s = (stub_t *) MALLOC(sizeof(stub_t));
+    s->cap = 1024;
+    s->lits = (int *) MALLOC(sizeof(int)*s->cap);
+    s->n = 0;
+    s->acap = 16;
+    s->assume = (int *) MALLOC(sizeof(int)*s->acap);
+    s->na = 0;
+    s->nv = 0;
+    s->val = (int *) MALLOC(sizeof(int));
+    s->val[0] = 0;
+    s->trail = (int *) MALLOC(sizeof(int));
+    s->nt = 0;
+    return s;
+}
+
+void ipasir_release(void *solver)
+{
+    stub_t *s = (stub_t *) solver;
+    FREE(s->lits);
+    FREE(s->assume);
+    FREE(s->val);
+    FREE(s->trail);
+    FREE(s);
+}
+
+void ipasir_add(void *solver, int lit_or_zero)
+{
+    stub_t *s = (stub_t *) solver;
+    if(s->n == s->cap) {
+        int *l = (int *) MALLOC(sizeof(int)*2*s->cap);
+        for(long i = 0; i < s->n; i++)
+            l[i] = s->lits[i];
+        FREE(s->lits);
+        s->lits = l;
+        s->cap *= 2;
+    }
+    s->lits[s->n++] = lit_or_zero;
+    stub_var(s, lit_or_zero);
+}
+
+void ipasir_assume(void *solver, int lit)
+{
+    stub_t *s = (stub_t *) solver;
+    if(s->na == s->acap) {
+        int *a = (int *) MALLOC(sizeof(int)*2*s->acap);
+        for(int i = 0; i < s->na; i++)
+            a[i] = s->assume[i];
+        FREE(s->assume);
+        s->assume = a;
+        s->acap *= 2;
+    }
+    s->assume[s->na++] = lit;
+    stub_var(s, lit);
+}
+
+/* Returns 10 (satisfiable) or 20 (unsatisfiable). The assignment of
+ * a satisfiable solve stays for 'ipasir_val' until the next call. */
+
+int ipasir_solve(void *solver)
+{
+    stub_t *s = (stub_t *) solver;
+    stub_undo(s, 0);
+    int result = 10;
+    for(int i = 0; i < s->na && result == 10; i++) {
+        int v = stub_lit(s, s->assume[i]);
+        if(v < 0)
+            result = 20;
+        else if(v == 0)
+            stub_set(s, s->assume[i]);
+    }
+    if(result == 10 && !stub_dpll(s))
+        result = 20;
+    if(result == 20)
+        stub_undo(s, 0);
+    s->na = 0;
+    return result;
+}
+
+int ipasir_val(void *solver, int lit)
+{
+    stub_t *s = (stub_t *) solver;
+    if(abs(lit) > s->nv)
+        return 0;
+    int v = stub_lit(s, lit);
+    return v > 0 ? lit : v < 0 ? -lit : 0;
+}
+
+int ipasir_failed(void *solver, int lit)
+{
+    (void) solver;
+    (void) lit;
+    return 0;
+}
+
+void ipasir_set_terminate(void *solver, void *data, 
+                          int (*terminate)(void *data))
+{
+    (void) solver;
+    (void) data;
+    (void) terminate;
+}
+
+void ipasir_set_learn(void *solver, void *data, int max_length, 
+                      void (*learn)(void *data, int *clause))
+{
+    (void) solver;
+    (void) data;
+    (void) max_length;
+    (void) learn;
+}
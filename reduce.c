@@ -36,11 +36,36 @@
 
 /******************************************************* Symmetry reduction. */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include "common.h"
 #include "graph.h"
+#include "cube.h"
+#include "zio.h"
+#include "ring.h"
+#include "reduce.h"
 #include "gmp.h"
+#ifdef HAVE_IPASIR
+#include "ipasir.h"
+#endif
+
+/* The library build (REDUCE_LIBRARY) leaves out the command line, the
+ * input formats and the printing, and exports only what 'reduce.h' 
+ * declares. */
+
+#ifndef REDUCE_LIBRARY
 
 /******************************* A rudimentary command-line argument parser. */
 
@@ -64,12 +89,29 @@ argdef_t argdefs[] = {
     { 'h', "help",          ARG_NO_PARAM },
     { 'u', "usage",         ARG_NO_PARAM },
     { 'v', "verbose",       ARG_NO_PARAM },
+    { 'q', "quiet",         ARG_NO_PARAM },
+    { 'L', "log",           ARG_STRING_PARAM },
+    { 'd', "decompose",     ARG_NO_PARAM },
+    { 'w', "twins",         ARG_NO_PARAM },
+    { 'b', "basic-graph",   ARG_NO_PARAM },
+    { 'P', "passthrough",   ARG_NO_PARAM },
     { 'g', "graph",         ARG_NO_PARAM },
     { 'n', "no-cnf",        ARG_NO_PARAM },
     { 's', "symmetry-only", ARG_NO_PARAM },
     { 'i', "incremental",   ARG_NO_PARAM },
+    { 'c', "cube-format",   ARG_STRING_PARAM },
+    { 'A', "solve",         ARG_NO_PARAM },
+    { 'B', "batch",         ARG_LONG_PARAM },
+    { 'M', "manifest",      ARG_NO_PARAM },
+    { 'D', "serve",         ARG_STRING_PARAM },
+    { 'F', "family",        ARG_STRING_PARAM },
     { 't', "threshold",     ARG_LONG_PARAM },
     { 'l', "length",        ARG_LONG_PARAM },
+    { 'S', "select",        ARG_STRING_PARAM },
+    { 'j', "threads",       ARG_LONG_PARAM },
+    { 'e', "estimate",      ARG_LONG_PARAM },
+    { 'H', "heartbeat",     ARG_LONG_PARAM },
+    { 'W', "status",        ARG_STRING_PARAM },
     { 'p', "prefix",        ARG_INT_ARRAY_PARAM },
     { 'f', "file",          ARG_STRING_PARAM },
     { 'o', "output",        ARG_STRING_PARAM },
@@ -369,13 +411,19 @@ void arg_print(FILE *out, argparse_t *p)
     }   
 }
 
+#endif
+
 /*************************************************** Reducer data structure. */
 
 struct reducer_struct
 {
     int         nv;              /* Number of variables in the CNF instance. */
     long        nc;              /* Number of clauses in the CNF instance. */
-    int         *clauses;        /* The clauses. */
+    int         *clauses;        /* The clauses (or NULL if dropped). */
+    long        *occ;            /* Occurrences of the CNF variables. */
+    FILE        *cnf_in;         /* Input to copy the clauses from. */
+    long        cnf_start;       /* Start of the clauses in the input. */
+    long        cnf_end;         /* End of the clauses in the input. */
     int         have_cnf;        /* Have CNF? */
 
     int         n;               /* Number of vertices in base graph. */
@@ -384,9 +432,13 @@ struct reducer_struct
     int         *var;            /* Variable vertices in base graph. */
     char        **var_legend;    /* String identifiers for the variables. */
     int         *var_trans;      /* Translation from graph to CNF variables. */ 
+    char        *lit_str;        /* Negative literals of CNF variables. */
+    int         *lit_off;        /* Offsets of the literals in lit_str. */
     int         r;               /* Number of values. */
     int         *val;            /* Value vertices in base graph. */
     char        **val_legend;    /* String identifiers for the values. */
+    int         *var_idx;        /* Translation from vertices to variables. */
+    int         *val_idx;        /* Translation from vertices to values. */
 
     long        t;               /* Threshold size for automorphism group. */
 
@@ -398,30 +450,53 @@ struct reducer_struct
     int         *asgn;           /* The value assignments in the sequence. */
 
     int         initialized;     /* Initialized? */
+    int         exhausted;       /* Cube iterator past the last cube? */
+    int         select;          /* Prefix selection strategy. */
+    int         threads;         /* Threads for the levels of the prefix. */
 
-    int         **orbits;        /* Indicators for prefix element orbits.*/
+    bitset_t    **orbits;        /* Indicators for prefix element orbits.*/
     int         *trav_sizes;     /* Traversal sizes. */
-    int         **trav_ind;      /* Traversal indicators. */
+    bitset_t    **trav_ind;      /* Traversal indicators. */
     int         ***traversals;   /* The traversal permutations. */
+    int         *trivial;        /* Candidates have trivial groups? */
+    int         separated;       /* Assignment edges apart from base edges? */
+    int         block;           /* Symmetric groups on variable blocks? */
+    int         *block_of;       /* Block of each vertex (or -1). */
+    int         num_blocks;      /* Number of blocks. */
+    int         *block_len;      /* Lengths of the blocks. */
+    int         *block_cnt;      /* Value counts in each block. */
+    mpz_t       block_kern;      /* Order of the kernel on the variables. */
     graph_t     *last_prefix_g;  /* Last graph in the prefix sequence. */
+    int         spec_k;          /* Level expanded ahead (or -1). */
+    int         spec_ready;      /* Has the level ahead been expanded? */
+    pthread_t   spec_thread;     /* Helper expanding the level ahead. */
+    graph_t     *spec_g;         /* Prefix graph before the level ahead. */
+    graph_t     *spec_h;         /* Prefix graph up to the level ahead. */
     
     int         *work;           /* The work stack. */
-    int         **seed_min;      /* Indicators for seed-orbit minima. */
+    bitset_t    **seed_min;      /* Indicators for seed-orbit minima. */
     int         *scratch;        /* Scratch. */
     int         stack_top;       /* Position of the stack top. */ 
+    graph_t     *cand_g;         /* Reusable graph for candidate tests. */
+    int         *nu;             /* Reusable normalizing permutation. */
 
     long        *stat_gen;       /* Generated assignments. */
     long        *stat_can;       /* Canonical assignments. */
     long        *stat_out;       /* Assignments output. */
 
-    int         verbose;         /* Verbose output? */
+    int         probe;           /* Random probes instead of enumeration? */
+    unsigned long long rng;      /* State of the probe generator. */
+    long        beat;            /* Heartbeat interval in seconds (or 0). */
+    const char  *status_file;    /* Heartbeat file (or NULL for stderr). */
+    int         beat_countdown;  /* Nodes to generate before a clock check. */
+    time_t      beat_start;      /* Start of enumeration. */
+    time_t      beat_last;       /* Time of the last heartbeat. */
+    long        beat_last_gen;   /* Nodes generated at the last heartbeat. */
 };
 
-typedef struct reducer_struct reducer_t;
-
 /***************************************** Subroutines for orbit traversals. */
 
-int traversal_prepare(int ***trav, int root, graph_t *g)
+static int traversal_prepare(int ***trav, int root, graph_t *g)
 {
     int n = graph_order(g);
     if(root < 0 || root >= n)
@@ -481,7 +556,7 @@ int traversal_prepare(int ***trav, int root, graph_t *g)
     return len;
 }
 
-void traversal_release(int length, int **trav)
+static void traversal_release(int length, int **trav)
 {
     for(int i = 0; i < length; i++)
         FREE(trav[i]);
@@ -526,7 +601,7 @@ static void enlarge_p_array(void ***a, int capacity, int new_capacity)
     *a = t;
 }
 
-void reducer_enlarge_prefix(reducer_t *r, int capacity)
+static void reducer_enlarge_prefix(reducer_t *r, int capacity)
 {
     int c = r->prefix_capacity;
     
@@ -539,6 +614,7 @@ void reducer_enlarge_prefix(reducer_t *r, int capacity)
         enlarge_int_array(&r->trav_sizes, c, capacity);
         enlarge_p_array((void ***) &r->trav_ind, c, capacity);
         enlarge_p_array((void ***) &r->traversals, c, capacity);
+        enlarge_int_array(&r->trivial, c, capacity);
         enlarge_int_array(&r->work, 
                           (2*c+1)*(c+1), 
                           (2*capacity+1)*(capacity+1));
@@ -552,6 +628,8 @@ void reducer_enlarge_prefix(reducer_t *r, int capacity)
     r->prefix_capacity = capacity;
 }
 
+#ifndef REDUCE_LIBRARY
+
 void eat_comment_lines(FILE *in)
 {
     int c;
@@ -562,13 +640,548 @@ void eat_comment_lines(FILE *in)
         ungetc(c, in);
 }
 
-reducer_t *reducer_parse(FILE *in, argparse_t *p)
+#endif
+
+/************************************ Symmetry graphs built from the CNF. */
+
+/* 
+ * Both constructions number the vertices alike. The variables are 
+ * 0,1,...,nv-1, the negative literals nv,nv+1,...,2nv-1, the positive 
+ * literals 2nv,2nv+1,...,3nv-1, and the values 'false' and 'true' are 
+ * 3nv and 3nv+1. The clause vertices follow.
+ */
+
+static void color_graph(graph_t *g, int *colors)
+{
+    int n = graph_order(g);
+    for(int u = 0; u < n; u++)
+        if(colors[u] == -1)
+            ABORT("vertex u = %d did not receive a color", u);
+    int *lab = graph_lab(g);
+    int *ptn = graph_ptn(g);
+    heapsort_int_indirect(n, colors, lab);
+    for(int i = 0; i < n; i++)
+        if(i == n-1 || colors[lab[i]] != colors[lab[i+1]])
+            ptn[i] = 0;
+        else
+            ptn[i] = 1;    
+}
+
+static int literal_vertex(int nv, int l)
+{
+    if(l < 0) {
+        l = (-l)-1;
+        if(l >= nv)
+            ERROR("negative literal (%d) out of range", -(l + 1));
+        return nv + l;
+    } else {
+        l = l-1;
+        if(l >= nv)
+            ERROR("positive literal (%d) out of range", l + 1);
+        return 2*nv + l;
+    }
+}
+
+/* The basic construction has one vertex for each clause, joined to the
+ * vertices of its literals, and all clause vertices share a color. */
+
+static graph_t *cnf_graph_basic(reducer_t *r)
+{
+    int  nv = r->nv;
+    long nc = r->nc;
+    int   n = 3*nv + 2 + nc;
+
+    graph_t *g = graph_alloc(n);
+
+    for(int i = 0; i < nv; i++) {
+        graph_add_edge(g, i, nv + i);
+        graph_add_edge(g, i, 2*nv + i);
+    }
+
+    long cursor = 0;
+    int *buf = r->clauses;
+    for(long c = 0; c < nc; c++) {
+        int l;
+        while((l = buf[cursor++]) != 0)
+            graph_add_edge(g, literal_vertex(nv, l), 3*nv + 2 + c);
+    }
+
+    int *colors = (int *) MALLOC(sizeof(int)*n);
+    for(int i = 0; i < n; i++)
+        colors[i] = -1;
+    for(int i = 0; i < nv; i++)
+        colors[i] = 0;
+    for(int i = 0; i < nv; i++)
+        colors[nv + i] = 1;
+    for(int i = 0; i < nv; i++)
+        colors[2*nv + i] = 2;
+    colors[3*nv + 0] = 3;
+    colors[3*nv + 1] = 4;
+    for(long i = 0; i < nc; i++)
+        colors[3*nv + 2 + i] = 5;        
+    color_graph(g, colors);
+    FREE(colors);
+    return g;
+}
+
+/* The compact construction drops repeated literals and repeated clauses,
+ * joins the two literal vertices of each binary clause directly instead 
+ * of through a clause vertex, colors the clause vertices by clause length,
+ * and colors the variables by their numbers of positive and negative 
+ * occurrences. The automorphisms act on the CNF exactly as before. */
+
+typedef struct
+{
+    unsigned long   hash;
+    long            len;
+    long            idx;
+} clause_key_t;
+
+static int clause_key_compare(const void *x, const void *y)
+{
+    const clause_key_t *a = (const clause_key_t *) x;
+    const clause_key_t *b = (const clause_key_t *) y;
+    if(a->len != b->len)
+        return a->len < b->len ? -1 : 1;
+    if(a->hash != b->hash)
+        return a->hash < b->hash ? -1 : 1;
+    return a->idx < b->idx ? -1 : (a->idx > b->idx ? 1 : 0);
+}
+
+static graph_t *cnf_graph(reducer_t *r)
+{
+    int  nv = r->nv;
+    long nc = r->nc;
+    int *buf = r->clauses;
+
+    /* Sort the literals of each clause and drop repeats. The clauses are
+     * not needed afterwards with passthrough, so they are then compacted
+     * in place instead of copied; the writes never pass the reads. */
+    long total = 0;
+    for(long c = 0; c < nc; c++)
+        while(buf[total++] != 0)
+            ;
+    int in_place = r->cnf_in != NULL;
+    int *lits   = in_place ? buf : (int *) MALLOC(sizeof(int)*(total+1));
+    long *start = (long *) MALLOC(sizeof(long)*(nc+1));
+    clause_key_t *key = (clause_key_t *) MALLOC(sizeof(clause_key_t)*(nc+1));
+    long cursor = 0;
+    long w = 0;
+    for(long c = 0; c < nc; c++) {
+        int l;
+        start[c] = w;
+        while((l = buf[cursor++]) != 0) {
+            literal_vertex(nv, l);
+            lits[w++] = l;
+        }
+        heapsort_int((int) (w - start[c]), lits + start[c]);
+        long e = start[c];
+        for(long q = start[c]; q < w; q++)
+            if(q == start[c] || lits[q] != lits[q-1])
+                lits[e++] = lits[q];
+        w = e;
+        unsigned long h = 14695981039346656037UL;
+        for(long q = start[c]; q < w; q++) {
+            h ^= (unsigned int) lits[q];
+            h *= 1099511628211UL;
+        }
+        key[c].hash = h;
+        key[c].len  = w - start[c];
+        key[c].idx  = c;
+    }
+    start[nc] = w;
+
+    /* Mark the repeated clauses; the first occurrence is kept. */
+    int *keep = (int *) MALLOC(sizeof(int)*(nc+1));
+    qsort(key, nc, sizeof(clause_key_t), clause_key_compare);
+    for(long i = 0; i < nc; ) {
+        long j = i+1;
+        while(j < nc && 
+              key[j].len == key[i].len && key[j].hash == key[i].hash)
+            j++;
+        for(long s = i; s < j; s++) {
+            long c = key[s].idx;
+            keep[c] = 1;
+            for(long t = i; t < s && keep[c]; t++) {
+                long d = key[t].idx;
+                if(!keep[d])
+                    continue;
+                long q = 0;
+                while(q < key[s].len && lits[start[c]+q] == lits[start[d]+q])
+                    q++;
+                if(q == key[s].len)
+                    keep[c] = 0;
+            }
+        }
+        i = j;
+    }
+    FREE(key);
+
+    long ncv = 0;
+    for(long c = 0; c < nc; c++)
+        if(keep[c] && start[c+1] - start[c] != 2)
+            ncv++;
+    int n = 3*nv + 2 + ncv;
+    graph_t *g = graph_alloc(n);
+    int *colors = (int *) MALLOC(sizeof(int)*n);
+    for(int i = 0; i < n; i++)
+        colors[i] = -1;
+
+    for(int i = 0; i < nv; i++) {
+        graph_add_edge(g, i, nv + i);
+        graph_add_edge(g, i, 2*nv + i);
+    }
+
+    long *sig = (long *) MALLOC(sizeof(long)*nv);
+    for(int i = 0; i < nv; i++)
+        sig[i] = 0;
+    int v = 3*nv + 2;
+    for(long c = 0; c < nc; c++) {
+        if(!keep[c])
+            continue;
+        long len = start[c+1] - start[c];
+        int *a = lits + start[c];
+        for(long q = 0; q < len; q++) {
+            if(a[q] > 0)
+                sig[a[q]-1] += 1L << 32;
+            else
+                sig[-a[q]-1] += 1L;
+        }
+        if(len == 2) {
+            graph_add_edge(g, literal_vertex(nv, a[0]), 
+                              literal_vertex(nv, a[1]));
+        } else {
+            for(long q = 0; q < len; q++)
+                graph_add_edge(g, literal_vertex(nv, a[q]), v);
+            colors[v++] = (int) len;
+        }
+    }
+    FREE(keep);
+    FREE(start);
+    if(!in_place)
+        FREE(lits);
+
+    /* Rank the occurrence signatures (positive count, negative count). */
+    long *srt = (long *) MALLOC(sizeof(long)*(nv+1));
+    for(int i = 0; i < nv; i++)
+        srt[i] = sig[i];
+    heapsort_long(nv, srt);
+    int ns = 0;
+    for(int i = 0; i < nv; i++)
+        if(i == 0 || srt[i] != srt[i-1])
+            srt[ns++] = srt[i];
+    for(int i = 0; i < nv; i++) {
+        int lo = 0;
+        int hi = ns - 1;
+        while(lo < hi) {
+            int mid = (lo + hi)/2;
+            if(srt[mid] < sig[i])
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        colors[i] = lo;
+    }
+    FREE(srt);
+    FREE(sig);
+
+    for(int i = 0; i < nv; i++)
+        colors[nv + i] = ns;
+    for(int i = 0; i < nv; i++)
+        colors[2*nv + i] = ns + 1;
+    colors[3*nv + 0] = ns + 2;
+    colors[3*nv + 1] = ns + 3;
+    for(int u = 3*nv + 2; u < n; u++)
+        colors[u] += ns + 4;
+    color_graph(g, colors);
+    FREE(colors);
+    return g;
+}
+
+/* Returns a reducer without input and with an empty prefix. */
+
+static reducer_t *reducer_alloc(void)
 {
     reducer_t *r = (reducer_t *) MALLOC(sizeof(reducer_t));
 
-    r->verbose = 0;
-    if(arg_have(p, "verbose"))
-        r->verbose = 1;
+    r->select = 0;
+    r->threads = 1;
+    r->probe = 0;
+    r->beat = 0;
+    r->status_file = NULL;
+
+    r->have_cnf = 0;
+    r->clauses = NULL;
+    r->cnf_in = NULL;
+    r->k = 0;
+    r->a = 0;
+    r->t = 0;
+    r->prefix_capacity = 1;
+    r->prefix = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
+    r->asgn = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
+    r->target_length = 0;
+    r->last_prefix_g = (graph_t *) 0;
+    r->spec_k = -1;
+    r->var_trans = NULL;
+    r->initialized = 0;
+    r->exhausted = 0;
+    return r;
+}
+
+static void reducer_alloc_prefix(reducer_t *r, int capacity)
+{
+    FREE(r->prefix);
+    FREE(r->asgn);
+    r->prefix_capacity = capacity;
+    r->prefix = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
+    r->asgn = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
+}
+
+/* Takes over the len literals in buf that make up the nc clauses. */
+
+static void reducer_set_clauses(reducer_t *r, int nv, long nc, 
+                                int *buf, long len)
+{
+    r->nv = nv;
+    r->nc = nc;
+    r->clauses = buf;
+    r->occ = (long *) MALLOC(sizeof(long)*nv);
+    for(int i = 0; i < nv; i++)
+        r->occ[i] = 0;
+    for(long u = 0; u < len; u++)
+        if(buf[u] != 0)
+            r->occ[abs(buf[u])-1]++;
+    r->have_cnf = 1;
+}
+
+/* Sets up the symmetry graph built from the CNF, with the variables 
+ * named by their numbers and the values 'false' and 'true'. */
+
+static void reducer_cnf_symmetry(reducer_t *r, int basic)
+{
+    if(!r->have_cnf)
+        ERROR("cannot build the symmetry graph since no CNF was given");
+    int  nv = r->nv;
+    graph_t *g = basic ? cnf_graph_basic(r) : cnf_graph(r);
+    int   n = graph_order(g);
+
+    r->n = n;
+    r->base = g;
+
+    r->v = nv;
+    r->var = (int *) MALLOC(sizeof(int)*nv);
+    r->var_legend = (char **) MALLOC(sizeof(char *)*nv);
+    char temp[100];
+    for(int i = 0; i < nv; i++) {
+        sprintf(temp, "%d", i + 1);
+        r->var[i] = i;
+        r->var_legend[i] = (char *) MALLOC(sizeof(char)*(strlen(temp)+1));
+        strcpy(r->var_legend[i], temp);
+    }
+    
+    r->r = 2;
+    r->val = (int *) MALLOC(sizeof(int)*2);
+    r->val_legend = (char **) MALLOC(sizeof(char *)*2);
+
+    r->val[0] = 3*nv + 0;
+    {
+        const char *s = "false";
+        r->val_legend[0] = (char *) MALLOC(sizeof(char)*(strlen(s)+1));
+        strcpy(r->val_legend[0], s);
+    }       
+    r->val[1] = 3*nv + 1;
+    {
+        const char *s = "true";
+        r->val_legend[1] = (char *) MALLOC(sizeof(char)*(strlen(s)+1));
+        strcpy(r->val_legend[1], s);
+    }       
+}
+
+/* Checks the variable and value vertices and builds the translation 
+ * arrays from vertices to variable and value indices. */
+
+static void reducer_index(reducer_t *r)
+{
+    {
+        /* Test variables for repeated elements. */
+        int *q = (int *) MALLOC(sizeof(int)*r->v);
+        for(int i = 0; i < r->v; i++)
+            q[i] = r->var[i];
+        heapsort_int(r->v, q);
+        for(int i = 1; i < r->v; i++)
+            if(q[i-1] == q[i])
+                ERROR("variable list repeats an element (%d)", q[i] + 1);
+        FREE(q);
+    }
+    {
+        /* Test values for repeated elements. */
+        int *q = (int *) MALLOC(sizeof(int)*r->r);
+        for(int i = 0; i < r->r; i++)
+            q[i] = r->val[i];
+        heapsort_int(r->r, q);
+        for(int i = 1; i < r->r; i++)
+            if(q[i-1] == q[i])
+                ERROR("value list repeats an element (%d)", q[i] + 1);
+        FREE(q);
+    }
+
+    r->var_idx = (int *) MALLOC(sizeof(int)*r->n);
+    r->val_idx = (int *) MALLOC(sizeof(int)*r->n);
+    for(int i = 0; i < r->n; i++) {
+        r->var_idx[i] = -1;
+        r->val_idx[i] = -1;
+    }
+    for(int i = 0; i < r->v; i++)
+        r->var_idx[r->var[i]] = i;
+    for(int i = 0; i < r->r; i++)
+        r->val_idx[r->val[i]] = i;
+}
+
+/* Builds the translation from variable vertices to CNF variables, 
+ * which the legends of the variables give. */
+
+static void reducer_translate(reducer_t *r)
+{
+    r->var_trans = (int *) MALLOC(sizeof(int)*r->n);
+    if(r->have_cnf) {
+        /* Build the translation array from graph variable vertices
+         * to selected CNF variables. */
+
+        int *q = (int *) MALLOC(sizeof(int)*r->v);
+        for(int i = 0; i < r->n; i++)
+            r->var_trans[i] = -1;
+        for(int i = 0; i < r->v; i++) {
+            int u;
+            if(sscanf(r->var_legend[i], "%d", &u) != 1)
+                ERROR("parse error in variable legend '%s'", r->var_legend[i]);
+            u = u-1;
+            if(u < 0 || u >= r->nv)
+                ERROR("parsed CNF variable in legend (%d) is out of range",
+                      u + 1);
+            r->var_trans[r->var[i]] = u;
+            q[i] = u;
+        }
+        heapsort_int(r->v, q);
+        for(int i = 1; i < r->v; i++)
+            if(q[i-1] == q[i])
+                ERROR("repeated CNF variable (%d) in legend", q[i]+1);
+        FREE(q);
+
+        /* Precompute the output strings of the negative literals;
+         * a positive literal skips the sign. */
+
+        r->lit_str = (char *) MALLOC(sizeof(char)*(12*r->v+1));
+        r->lit_off = (int *) MALLOC(sizeof(int)*r->nv);
+        int pos = 0;
+        for(int i = 0; i < r->v; i++) {
+            int u = r->var_trans[r->var[i]];
+            r->lit_off[u] = pos;
+            pos += format_long(r->lit_str + pos, -(u+1));
+            r->lit_str[pos++] = '\0';
+        }
+                
+        /* Build the translation array from graph false/true vertices
+         * to CNF values, i.e. make sure false and true are present
+         * and in this order. */
+
+        if(r->r != 2)
+            ERROR("value range does not consist of 'false' and 'true'");
+        if(!strcmp(r->val_legend[0], "true") &&
+           !strcmp(r->val_legend[1], "false")) {
+            int t = r->val[0];
+            r->val[0] = r->val[1];
+            r->val[1] = t;
+            char *s = r->val_legend[0];
+            r->val_legend[0] = r->val_legend[1];
+            r->val_legend[1] = s;
+            r->val_idx[r->val[0]] = 0;
+            r->val_idx[r->val[1]] = 1;
+        } else {
+            if(!(!strcmp(r->val_legend[1], "true") &&
+                 !strcmp(r->val_legend[0], "false")))
+                ERROR("value range does not consist of 'false' and 'true'");
+        }                               
+    } else {
+        for(int i = 0; i < r->v; i++)
+            r->var_trans[i] = i;
+    }
+}
+
+/* Checks that the prefix consists of distinct variable vertices. */
+
+static void reducer_check_prefix(reducer_t *r)
+{
+    for(int i = 0; i < r->k; i++)
+        if(r->prefix[i] < 0 || r->prefix[i] >= r->n)
+            ERROR("prefix element (%d) out of bounds", r->prefix[i]+1);
+    {
+        /* Test prefix for repeated elements. */
+        int *q = (int *) MALLOC(sizeof(int)*r->k);
+        for(int i = 0; i < r->k; i++)
+            q[i] = r->prefix[i];
+        heapsort_int(r->k, q);
+        for(int i = 1; i < r->k; i++)
+            if(q[i-1] == q[i])
+                ERROR("prefix repeats an element (%d)", q[i] + 1);
+        FREE(q);
+    }
+    for(int i = 0; i < r->k; i++)
+        if(r->var_idx[r->prefix[i]] == -1)
+            ERROR("prefix element (%d) is not a declared variable vertex", 
+                  r->prefix[i]+1);
+}
+
+#ifndef REDUCE_LIBRARY
+
+/* Completes a reducer with the prefix and the options from the command
+ * line, once the instance and any prefix in it have been read. */
+
+static void reducer_configure(reducer_t *r, argparse_t *p)
+{
+    if(arg_have(p, "prefix")) {
+        /* Build the prefix from the command line argument. */
+        
+        int *q = arg_int_array(p, "prefix");
+        int k = q[0];
+        q++;
+        int a = 0;
+        long t = 0;
+        if(k < 0 || a < 0 || a > k || t < 0)
+            ERROR("bad prefix parameters k = %d, a = %d, t = %ld", k, a, t);
+        reducer_alloc_prefix(r, k);
+        r->k = k;
+        r->a = a;
+        r->t = t;
+        for(int i = 0; i < k; i++) {
+            if(q[i] < 0 || q[i] >= r->n)
+                ERROR("prefix element (%d) out of bounds", q[i]+1);
+            r->prefix[i] = q[i];
+        }
+    }
+    if(arg_have(p, "length"))
+        r->target_length = arg_long(p, "length");
+    else
+        r->target_length = r->k;
+    if(r->target_length <= 0 &&
+       r->k == 0)
+        ERROR("no prefix given and nonpositive target length for prefix "
+              "-- nothing to do");
+    if(r->k > r->target_length)
+        ERROR("length of given prefix exceeds given target length for prefix");
+
+    reducer_index(r);
+    reducer_translate(r);
+    reducer_check_prefix(r);
+
+    if(arg_have(p, "decompose"))
+        graph_set_decompose(r->base, 1);
+    if(arg_have(p, "twins"))
+        graph_set_twins(r->base, 1);
+}
+
+reducer_t *reducer_parse(FILE *in, argparse_t *p)
+{
+    reducer_t *r = reducer_alloc();
 
     if(!arg_have(p, "no-cnf")) {
         /* Parse CNF from input. */
@@ -581,6 +1194,12 @@ reducer_t *reducer_parse(FILE *in, argparse_t *p)
             ERROR("bad number-of-variables parameter (n = %d) in CNF", nv);
         if(nc < 0)
             ERROR("bad number-of-clauses parameter (c = %ld) in CNF", nc);
+        if(arg_have(p, "passthrough")) {
+            /* Remember where the clauses are to copy them unchanged. */
+            if((r->cnf_start = ftell(in)) < 0)
+                ERROR("passthrough needs a seekable input");
+            r->cnf_in = in;
+        }
         long cursor = 0;
         long buffer_capacity = 128;
         int *buf = (int *) MALLOC(sizeof(int)*buffer_capacity);
@@ -595,8 +1214,8 @@ reducer_t *reducer_parse(FILE *in, argparse_t *p)
                     ERROR("bad literal %d in CNF input (n = %d)", l, nv);
                 if(cursor == buffer_capacity) {
                     int *temp = buf;
-                    int new_capacity = 2*buffer_capacity;
-                    buf = (int *) MALLOC(sizeof(int)*2*new_capacity);
+                    long new_capacity = 2*buffer_capacity;
+                    buf = (int *) MALLOC(sizeof(int)*new_capacity);
                     for(long u = 0; u < buffer_capacity; u++)
                         buf[u] = temp[u];
                     buffer_capacity = new_capacity;
@@ -607,14 +1226,11 @@ reducer_t *reducer_parse(FILE *in, argparse_t *p)
                     break;
             }
         }
+        if(r->cnf_in != NULL)
+            r->cnf_end = ftell(in);
         eat_comment_lines(in);
-        r->nv = nv;
-        r->nc = nc;
-        r->clauses = buf;
-        r->have_cnf = 1;
+        reducer_set_clauses(r, nv, nc, buf, cursor);
         fscanf(in, "\n");
-    } else {
-        r->have_cnf = 0;
     }
         
     if(arg_have(p, "graph")) {
@@ -666,100 +1282,12 @@ reducer_t *reducer_parse(FILE *in, argparse_t *p)
     } else {
         /* Build the graph of symmetries from CNF. */
 
-        if(!r->have_cnf)
-            ERROR("cannot build the symmetry graph since no CNF was given");
-        int  nv = r->nv;
-        long nc = r->nc;
-        int   n = 3*nv + 2 + nc;
-
-        graph_t *g = graph_alloc(n);
-
-        for(int i = 0; i < nv; i++) {
-            graph_add_edge(g, i, nv + i);
-            graph_add_edge(g, i, 2*nv + i);
-        }
-
-        long cursor = 0;
-        int *buf = r->clauses;
-        for(long c = 0; c < nc; c++) {
-            while(1) {
-                int l = buf[cursor++];
-                if(l == 0) {
-                    break;
-                } else {
-                    if(l < 0) {
-                        l = (-l)-1;
-                        if(l >= nv)
-                            ERROR("negative literal (%d) out of range", 
-                                  -(l + 1));
-                        graph_add_edge(g, nv + l, 3*nv + 2 + c);
-                    } else {
-                        l = l-1;
-                        if(l >= nv)
-                            ERROR("positive literal (%d) out of range", 
-                                  l + 1);
-                        graph_add_edge(g, 2*nv + l, 3*nv + 2 + c);
-                    }
-                }
-            }
-        }
-
-        int *colors = (int *) MALLOC(sizeof(int)*n);
-        for(int i = 0; i < n; i++)
-            colors[i] = -1;
-        for(int i = 0; i < nv; i++)
-            colors[i] = 0;
-        for(int i = 0; i < nv; i++)
-            colors[nv + i] = 1;
-        for(int i = 0; i < nv; i++)
-            colors[2*nv + i] = 2;
-        colors[3*nv + 0] = 3;
-        colors[3*nv + 1] = 4;
-        for(long i = 0; i < nc; i++)
-            colors[3*nv + 2 + i] = 5;        
-        for(int u = 0; u < n; u++)
-            if(colors[u] == -1)
-                ABORT("vertex u = %d did not receive a color", u);
-        int *lab = graph_lab(g);
-        int *ptn = graph_ptn(g);
-        heapsort_int_indirect(n, colors, lab);
-        for(int i = 0; i < n; i++)
-            if(i == n-1 || colors[lab[i]] != colors[lab[i+1]])
-                ptn[i] = 0;
-            else
-                ptn[i] = 1;    
-        FREE(colors);
-
-        r->n = n;
-        r->base = g;
-
-        r->v = nv;
-        r->var = (int *) MALLOC(sizeof(int)*nv);
-        r->var_legend = (char **) MALLOC(sizeof(char *)*nv);
-        char temp[100];
-        for(int i = 0; i < nv; i++) {
-            sprintf(temp, "%d", i + 1);
-            r->var[i] = i;
-            r->var_legend[i] = (char *) MALLOC(sizeof(char)*(strlen(temp)+1));
-            strcpy(r->var_legend[i], temp);
-        }
-        
-        r->r = 2;
-        r->val = (int *) MALLOC(sizeof(int)*2);
-        r->val_legend = (char **) MALLOC(sizeof(char *)*2);
-
-        r->val[0] = 3*nv + 0;
-        {
-            const char *s = "false";
-            r->val_legend[0] = (char *) MALLOC(sizeof(char)*(strlen(s)+1));
-            strcpy(r->val_legend[0], s);
-        }       
-        r->val[1] = 3*nv + 1;
-        {
-            const char *s = "true";
-            r->val_legend[1] = (char *) MALLOC(sizeof(char)*(strlen(s)+1));
-            strcpy(r->val_legend[1], s);
-        }       
+        reducer_cnf_symmetry(r, arg_have(p, "basic-graph"));
+    }
+    if(r->have_cnf && r->cnf_in != NULL) {
+        /* The clauses are copied from the input on output. */
+        FREE(r->clauses);
+        r->clauses = NULL;
     }
     if(!arg_have(p, "prefix") && !arg_have(p, "length")) {
         /* Read the prefix from input. */
@@ -772,12 +1300,10 @@ reducer_t *reducer_parse(FILE *in, argparse_t *p)
             ERROR("parse error -- prefix format line expected");
         if(k < 0 || a < 0 || a > k || t < 0)
             ERROR("bad prefix parameters k = %d, a = %d, t = %ld", k, a, t);
-        r->prefix_capacity = k;
+        reducer_alloc_prefix(r, k);
         r->k = k;
         r->a = a;
         r->t = t;
-        r->prefix = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
-        r->asgn = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
         
         /* Caveat: remove assignment feature 
          *         -- or repair bad assignment check */
@@ -799,164 +1325,40 @@ reducer_t *reducer_parse(FILE *in, argparse_t *p)
                 ERROR("bad assignment u = %d", u);
             r->prefix[i] = u-1;
         }
-    } else {
-        if(arg_have(p, "prefix")) {
-            /* Build the prefix from the command line argument. */
-            
-            int *q = arg_int_array(p, "prefix");
-            int k = q[0];
-            q++;
-            int a = 0;
-            long t = 0;
-            if(k < 0 || a < 0 || a > k || t < 0)
-                ERROR("bad prefix parameters k = %d, a = %d, t = %ld", k, a, t);
-            r->prefix_capacity = k;
-            r->k = k;
-            r->a = a;
-            r->t = t;
-            r->prefix = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
-            r->asgn = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
-            for(int i = 0; i < k; i++) {
-                if(q[i] < 0 || q[i] >= r->n)
-                    ERROR("prefix element (%d) out of bounds", q[i]+1);
-                r->prefix[i] = q[i];
-            }
-        } else {
-            r->k = 0;
-            r->a = 0;
-            r->t = 0;
-            r->prefix_capacity = 1;
-            r->prefix = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
-            r->asgn = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
-        }
-    }
-    if(arg_have(p, "length"))
-        r->target_length = arg_long(p, "length");
-    else
-        r->target_length = r->k;
-    if(r->target_length <= 0 &&
-       r->k == 0)
-        ERROR("no prefix given and nonpositive target length for prefix "
-              "-- nothing to do");
-    if(r->k > r->target_length)
-        ERROR("length of given prefix exceeds given target length for prefix");
-
-    r->last_prefix_g = (graph_t *) 0;
-
-    {
-        /* Test variables for repeated elements. */
-        int *q = (int *) MALLOC(sizeof(int)*r->v);
-        for(int i = 0; i < r->v; i++)
-            q[i] = r->var[i];
-        heapsort_int(r->v, q);
-        for(int i = 1; i < r->v; i++)
-            if(q[i-1] == q[i])
-                ERROR("variable list repeats an element (%d)", q[i] + 1);
-        FREE(q);
-    }
-    {
-        /* Test values for repeated elements. */
-        int *q = (int *) MALLOC(sizeof(int)*r->r);
-        for(int i = 0; i < r->r; i++)
-            q[i] = r->val[i];
-        heapsort_int(r->r, q);
-        for(int i = 1; i < r->r; i++)
-            if(q[i-1] == q[i])
-                ERROR("value list repeats an element (%d)", q[i] + 1);
-        FREE(q);
-    }
-    {
-        /* Test prefix for repeated elements. */
-        int *q = (int *) MALLOC(sizeof(int)*r->k);
-        for(int i = 0; i < r->k; i++)
-            q[i] = r->prefix[i];
-        heapsort_int(r->k, q);
-        for(int i = 1; i < r->k; i++)
-            if(q[i-1] == q[i])
-                ERROR("prefix repeats an element (%d)", q[i] + 1);
-        FREE(q);
-    }
-
-    r->var_trans = (int *) MALLOC(sizeof(int)*r->n);
-    if(r->have_cnf) {
-        /* Build the translation array from graph variable vertices
-         * to selected CNF variables. */
-
-        int *q = (int *) MALLOC(sizeof(int)*r->v);
-        for(int i = 0; i < r->n; i++)
-            r->var_trans[i] = -1;
-        for(int i = 0; i < r->v; i++) {
-            int u;
-            if(sscanf(r->var_legend[i], "%d", &u) != 1)
-                ERROR("parse error in variable legend '%s'", r->var_legend[i]);
-            u = u-1;
-            if(u < 0 || u >= r->nv)
-                ERROR("parsed CNF variable in legend (%d) is out of range",
-                      u + 1);
-            r->var_trans[r->var[i]] = u;
-            q[i] = u;
-        }
-        heapsort_int(r->v, q);
-        for(int i = 1; i < r->v; i++)
-            if(q[i-1] == q[i])
-                ERROR("repeated CNF variable (%d) in legend", q[i]+1);
-        FREE(q);
-                
-        /* Build the translation array from graph false/true vertices
-         * to CNF values, i.e. make sure false and true are present
-         * and in this order. */
-
-        if(r->r != 2)
-            ERROR("value range does not consist of 'false' and 'true'");
-        if(!strcmp(r->val_legend[0], "true") &&
-           !strcmp(r->val_legend[1], "false")) {
-            int t = r->val[0];
-            r->val[0] = r->val[1];
-            r->val[1] = t;
-            char *s = r->val_legend[0];
-            r->val_legend[0] = r->val_legend[1];
-            r->val_legend[1] = s;
-        } else {
-            if(!(!strcmp(r->val_legend[1], "true") &&
-                 !strcmp(r->val_legend[0], "false")))
-                ERROR("value range does not consist of 'false' and 'true'");
-        }                               
-    } else {
-        for(int i = 0; i < r->v; i++)
-            r->var_trans[i] = i;
     }
-    for(int i = 0; i < r->k; i++)
-        if(r->var_trans[r->prefix[i]] == -1)
-            ERROR("prefix element (%d) is not a declared variable vertex", 
-                  r->prefix[i]+1);
-
-    r->initialized = 0;
-    
+    reducer_configure(r, p);
     return r;
 }
 
+#endif
+
 /****************************************** Initialize a configured reducer. */
 
 
-static void orbit_min_ind(graph_t *g, int *relabel, int *ind)
+/* Marks the orbit minima among the l variable vertices in m, 
+ * optionally relabeled. The variables are a union of orbits, 
+ * so their minima are the only ones that are ever looked up. */
+
+static void orbit_min_ind(graph_t *g, int l, const int *m, 
+                          int *relabel, bitset_t *ind)
 {
     int n = graph_order(g);
-    const int *p = graph_orbit_cells(g);
     const int *c = graph_orbits(g);
-    for(int i = 0; i < n; i++)
-        ind[i] = 0;
-    for(int i = 0; i < n; i++) {
-        if(relabel != NULL)
-            ind[relabel[p[i]]] = 1;
-        else
-            ind[p[i]] = 1;
-        int j = i+1;
-        for(; j < n && c[p[i]] == c[p[j]]; j++)
-            ;
-        i = j-1;
+    bitset_clear(n, ind);
+    for(int i = 0; i < l; i++) {
+        int u = m[i];
+        if(c[u] == u)
+            BITSET_ADD(ind, relabel != NULL ? relabel[u] : u);
     }    
 }
 
+static void orbit_all_ind(int n, int l, const int *m, bitset_t *ind)
+{
+    bitset_clear(n, ind);
+    for(int i = 0; i < l; i++)
+        BITSET_ADD(ind, m[i]);
+}
+
 static void print_aut_order(FILE *out, graph_t *g)
 {
     mpz_t aut_order;
@@ -976,17 +1378,17 @@ static void print_orbit_perms(FILE *out, graph_t *g, int l, int *m)
 {
     int n = graph_order(g);
     const int *p = graph_orbit_cells(g);
-    const int *c = graph_orbits(g);
+    const int *start = graph_orbit_starts(g);
+    int nc = graph_orbit_ncells(g);
     int *q = (int *) MALLOC(sizeof(int)*n);
     for(int u = 0; u < n; u++)
         q[u] = 0;
     for(int u = 0; u < l; u++)
         q[m[u]] = 1;
 
-    for(int i = 0; i < n; i++) {
-        int j = i+1;
-        for(; j < n && c[p[i]] == c[p[j]]; j++)
-            ;
+    for(int o = 0; o < nc; o++) {
+        int i = start[o];
+        int j = start[o+1];
         if(q[p[i]] > 0) {
             fprintf(out, "orbit: ");
             print_int_array(out, j - i, p + i);
@@ -1027,7 +1429,6 @@ static void print_orbit_perms(FILE *out, graph_t *g, int l, int *m)
                 fprintf(out, " -- fix = %d, move = %d\n", num_fixed, num_moved);
             }
         }
-        i = j-1;
     }
 
     FREE(q);
@@ -1036,11 +1437,12 @@ static void print_orbit_perms(FILE *out, graph_t *g, int l, int *m)
 static int orbit_select(graph_t *g, 
                         int l, int *m, 
                         int k, int *f,
-                        int *t)
+                        const bitset_t *t)
 {
     int n = graph_order(g);
     const int *p = graph_orbit_cells(g);
-    const int *c = graph_orbits(g);
+    const int *start = graph_orbit_starts(g);
+    int nc = graph_orbit_ncells(g);
     int *q = (int *) MALLOC(sizeof(int)*n);
     for(int u = 0; u < n; u++)
         q[u] = 0;
@@ -1051,8 +1453,8 @@ static int orbit_select(graph_t *g,
 
     /* By default select the first point from the previous orbit, if any. */
     if(t != NULL) {
-        for(int i = 0; i < n; i++) {
-            if(q[i] > 0 && t[i] > 0) {
+        for(int i = bitset_next(n, t, 0); i >= 0; i = bitset_next(n, t, i+1)) {
+            if(q[i] > 0) {
                 FREE(q);
                 return i;
             }
@@ -1067,10 +1469,9 @@ static int orbit_select(graph_t *g,
     int have_good = 0;
     int have_first_eligible = 0;
     int first_eligible = -1;
-    for(int i = 0; i < n; i++) {
-        int j = i+1;
-        for(; j < n && c[p[i]] == c[p[j]]; j++)
-            ;
+    for(int o = 0; o < nc; o++) {
+        int i = start[o];
+        int j = start[o+1];
         if(q[p[i]] > 0) {
             if(!have_first_eligible) {
                 have_first_eligible = 1;
@@ -1115,7 +1516,6 @@ static int orbit_select(graph_t *g,
                 }
             }
         }
-        i = j-1;
     }
     
     FREE(q);
@@ -1127,184 +1527,903 @@ static int orbit_select(graph_t *g,
         return first_eligible;
 }
 
+/********************************************** Prefix selection strategies. */
+
+/* Each strategy picks the next prefix point among the variable vertices 
+ * not yet in the prefix, given the graph g of the first k prefix points. */
+
+typedef int (*select_func_t)(reducer_t *r, graph_t *g, int k);
 
-graph_t *reducer_expand_prefix(reducer_t *r, int k, int p, graph_t *prev)
+#define SELECT_WIDTH 8 /* Orbits inspected at each lookahead level. */
+
+static int *select_eligible(reducer_t *r, int k)
 {
-    if(!r->initialized)
-        ABORT("cannot expand an uninitialized prefix");
-    if(k + 1 >= r->prefix_capacity)
-        reducer_enlarge_prefix(r, 2*r->prefix_capacity+1);
+    int *q = (int *) MALLOC(sizeof(int)*r->n);
+    for(int u = 0; u < r->n; u++)
+        q[u] = 0;
+    for(int u = 0; u < r->v; u++)
+        q[r->var[u]] = 1;
+    for(int u = 0; u < k; u++)
+        q[r->prefix[u]] = 0;
+    return q;
+}
 
-    push_time();
-    r->prefix[k] = p;
-    if(k > r->k)
-        ABORT("unsupported expansion");
-    if(r->k == k) {
-        r->stat_gen[k] = 0;
-        r->stat_can[k] = 0;
-        r->stat_out[k] = 0;
-        r->k = k+1;
-    }
+/* Collects into c the first points of at most w eligible orbits,
+ * longest orbits first, and returns their number. */
 
-    graph_t *g = prev;
-    if(g == NULL) {
-        g = graph_dup(r->base);
-        for(int j = 0; j < k; j++)
-            graph_add_edge(g, r->prefix[j], r->val[0]);
-    }
-    fprintf(stderr, "graph [%d]:", k);
-    print_aut_order(stderr, g);
-    fprintf(stderr, "\n");
-
-    if(k == 0) {
-        /* Check the base graph against the variable and value lists. */
-
-        const int *p = graph_orbit_cells(g);
-        const int *c = graph_orbits(g);
-        int *q = (int *) MALLOC(sizeof(int)*r->n);
-        for(int j = 0; j < r->n; j++)
-            q[j] = 0;
-        for(int j = 0; j < r->v; j++)
-            q[r->var[j]] = 1;
-        for(int s = 0; s < r->n; s++) {
-            int u = s+1;
-            for(; c[p[s]] == c[p[u]] && u < r->n; u++)
-                ;
-            for(int j = s+1; j < u; j++)
-                if(q[p[j]] != q[p[s]])
-                    ERROR("variable list is not a union of "
-                          "orbits of base graph "
-                          "(%d and %d have different orbits)",
-                          p[j] + 1, p[s] + 1);
-            s = u-1;
+static int select_candidates(graph_t *g, const int *q, int w, int *c)
+{
+    const int *p = graph_orbit_cells(g);
+    const int *start = graph_orbit_starts(g);
+    int nc = graph_orbit_ncells(g);
+    int *len = (int *) MALLOC(sizeof(int)*(w+1));
+    int m = 0;
+    for(int o = 0; o < nc; o++) {
+        int i = start[o];
+        int j = start[o+1];
+        if(q[p[i]] == 0)
+            continue;
+        int s = m < w ? m++ : w;
+        while(s > 0 && len[s-1] < j-i) {
+            if(s < w) {
+                len[s] = len[s-1];
+                c[s] = c[s-1];
+            }
+            s--;
+        }
+        if(s < w) {
+            len[s] = j-i;
+            c[s] = p[i];
         }
-        FREE(q);
-        for(int j = 0; j < r->n; j++)
-            for(int s = 0; s < r->r; s++)
-                if(p[j] == r->val[s] &&
-                   ((j > 0 && c[p[j-1]] == c[p[j]])||
-                    (j < r->n - 1 && c[p[j]] == c[p[j+1]])))
-                    ERROR("value vertex (%d) is not fixed by the automorphism "
-                          "group of the base graph", r->val[s] + 1);
     }
+    FREE(len);
+    return m;
+}
 
-    fprintf(stderr, "   orbits = [");
-    graph_print_orbits(stderr, g, r->v, r->var);
-    fprintf(stderr, "]\n");
-
-    if(r->verbose) {
-        print_orbit_perms(stderr, g, r->v, r->var);
-        fprintf(stderr, "select = %d\n", orbit_select(g, r->v, r->var,
-                                                      k, r->prefix,
-                                                      k > 0 ?
-                                                      r->trav_ind[k-1] : 
-                                                      NULL));
+static void group_order(mpz_t a, graph_t *g)
+{
+    mpz_set_si(a, 1L);
+    const int *ai = graph_aut_idx(g);
+    while(*ai != 0) {
+        mpz_mul_si(a, a, (long) *ai);
+        ai++;
     }
+}
 
-    fprintf(stderr, "prefix[%d] = %d:", k + 1, r->prefix[k] + 1);
-    r->orbits[k] = (int *) MALLOC(sizeof(int)*r->n);
-    r->trav_ind[k] = (int *) MALLOC(sizeof(int)*r->n);
-    r->seed_min[k] = (int *) MALLOC(sizeof(int)*r->n);
-
-    push_time();
-    r->trav_sizes[k] = traversal_prepare(r->traversals + k,
-                                         r->prefix[k],
-                                         g);
-    pop_print_time("traversal");
-    graph_free(g);
+/* Returns a copy of g with x joined to the first value vertex,
+ * i.e. the graph that results from appending x to the prefix. */
 
-    int *a = (int *) MALLOC(sizeof(int)*r->trav_sizes[k]);
-    for(int j = 0; j < r->trav_sizes[k]; j++)
-        a[j] = r->traversals[k][j][r->prefix[k]];
-    for(int i = 0; i < r->n; i++)
-        r->trav_ind[k][i] = 0;
-    for(int j = 0; j < r->trav_sizes[k]; j++)
-        r->trav_ind[k][a[j]] = 1;
-    fprintf(stderr, "\n   traversal: ");
-    print_int_array(stderr, r->trav_sizes[k], a);
-    fprintf(stderr, " [length = %d]\n", r->trav_sizes[k]);
-    FREE(a);
+static graph_t *select_extend(reducer_t *r, graph_t *g, int x)
+{
+    graph_t *h = graph_dup(g);
+    graph_add_edge(h, x, r->val[0]);
+    return h;
+}
 
-    g = graph_dup(r->base);
-    for(int j = 0; j <= k; j++)
-        graph_add_edge(g, r->prefix[j], r->val[0]);
-    for(int j = 0; j < r->n; j++)
-        r->orbits[k][j] = graph_same_orbit(g, r->prefix[k], j);
+static int select_default(reducer_t *r, graph_t *g, int k)
+{
+    return orbit_select(g, r->v, r->var, k, r->prefix,
+                        k > 0 ? r->trav_ind[k-1] : NULL);
+}
 
-    pop_print_time("prefix_total");
-    fprintf(stderr, "\n");
+/* Choose a nontrivial orbit of the minimum length. */
 
-    return g;
+static int select_smallest(reducer_t *r, graph_t *g, int k)
+{
+    int *q = select_eligible(r, k);
+    const int *p = graph_orbit_cells(g);
+    const int *start = graph_orbit_starts(g);
+    int nc = graph_orbit_ncells(g);
+    int first_eligible = -1;
+    int min_length = -1;
+    int min_p = -1;
+    for(int o = 0; o < nc; o++) {
+        int i = start[o];
+        int j = start[o+1];
+        if(q[p[i]] == 0)
+            continue;
+        if(first_eligible < 0)
+            first_eligible = p[i];
+        if(j-i >= 2 && (min_length < 0 || j-i < min_length)) {
+            min_length = j-i;
+            min_p = p[i];
+        }
+    }
+    FREE(q);
+    if(first_eligible < 0)
+        ABORT("no eligible orbit");
+    return min_p >= 0 ? min_p : first_eligible;
 }
 
-void reducer_initialize(reducer_t *r)
-{
-    if(r->initialized)
-        return;
+/* Choose the orbit whose variables occur in the most clauses,
+ * breaking ties towards longer orbits. */
 
-    int k = r->k;
-    if(k > r->prefix_capacity)
-        ABORT("prefix overrun at init");
+static int select_occurrence(reducer_t *r, graph_t *g, int k)
+{
+    const long *occ = r->occ;
+    int *q = select_eligible(r, k);
+    const int *p = graph_orbit_cells(g);
+    const int *start = graph_orbit_starts(g);
+    int nc = graph_orbit_ncells(g);
+    long max_occ = -1;
+    int max_length = -1;
+    int max_p = -1;
+    for(int o = 0; o < nc; o++) {
+        int i = start[o];
+        int j = start[o+1];
+        if(q[p[i]] == 0)
+            continue;
+        long w = occ[r->var_trans[p[i]]];
+        if(w > max_occ || (w == max_occ && j-i > max_length)) {
+            max_occ = w;
+            max_length = j-i;
+            max_p = p[i];
+        }
+    }
+    FREE(q);
+    if(max_p < 0)
+        ABORT("no eligible orbit");
+    return max_p;
+}
 
-    push_time();
+/* Choose the point whose addition to the prefix leaves 
+ * the smallest automorphism group. */
 
-    r->orbits = (int **) MALLOC(sizeof(int *)*r->prefix_capacity);
-    r->trav_sizes = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
-    r->trav_ind = (int **) MALLOC(sizeof(int *)*r->prefix_capacity);
-    r->traversals = (int ***) MALLOC(sizeof(int **)*r->prefix_capacity);
+static int select_stabilizer(reducer_t *r, graph_t *g, int k)
+{
+    int *q = select_eligible(r, k);
+    int nc = graph_orbit_ncells(g);
+    int *c = (int *) MALLOC(sizeof(int)*nc);
+    int m = select_candidates(g, q, nc, c);
+    if(m == 0)
+        ABORT("no eligible orbit");
+    mpz_t a, min_a;
+    mpz_init(a);
+    mpz_init(min_a);
+    int min_p = -1;
+    for(int s = 0; s < m; s++) {
+        graph_t *h = select_extend(r, g, c[s]);
+        group_order(a, h);
+        graph_free(h);
+        if(min_p < 0 || mpz_cmp(a, min_a) < 0) {
+            mpz_set(min_a, a);
+            min_p = c[s];
+        }
+    }
+    mpz_clear(min_a);
+    mpz_clear(a);
+    FREE(c);
+    FREE(q);
+    return min_p;
+}
 
-    r->work = (int *) MALLOC(sizeof(int)*(2*r->prefix_capacity+1)
-                                        *(r->prefix_capacity+1));
-    r->seed_min = (int **) MALLOC(sizeof(int *)*r->prefix_capacity);
-    r->scratch = (int *) MALLOC(sizeof(int)*(2*r->prefix_capacity+2));
-    r->stack_top = 0; /* The stack is empty. */
+/* As above, but rank the points of the SELECT_WIDTH longest orbits 
+ * by the smallest group reachable with one further point. */
 
+static int select_lookahead(reducer_t *r, graph_t *g, int k)
+{
+    int *q = select_eligible(r, k);
+    int c[SELECT_WIDTH];
+    int d[SELECT_WIDTH];
+    int m = select_candidates(g, q, SELECT_WIDTH, c);
+    if(m == 0)
+        ABORT("no eligible orbit");
+    mpz_t a1, a2, b, min_a1, min_a2;
+    mpz_init(a1);
+    mpz_init(a2);
+    mpz_init(b);
+    mpz_init(min_a1);
+    mpz_init(min_a2);
+    int min_p = -1;
+    for(int s = 0; s < m; s++) {
+        graph_t *h = select_extend(r, g, c[s]);
+        group_order(a1, h);
+        mpz_set(a2, a1);
+        q[c[s]] = 0;
+        int mm = select_candidates(h, q, SELECT_WIDTH, d);
+        for(int t = 0; t < mm; t++) {
+            graph_t *hh = select_extend(r, h, d[t]);
+            group_order(b, hh);
+            graph_free(hh);
+            if(mpz_cmp(b, a2) < 0)
+                mpz_set(a2, b);
+        }
+        q[c[s]] = 1;
+        graph_free(h);
+        if(min_p < 0 || 
+           mpz_cmp(a2, min_a2) < 0 ||
+           (mpz_cmp(a2, min_a2) == 0 && mpz_cmp(a1, min_a1) < 0)) {
+            mpz_set(min_a1, a1);
+            mpz_set(min_a2, a2);
+            min_p = c[s];
+        }
+    }
+    mpz_clear(min_a2);
+    mpz_clear(min_a1);
+    mpz_clear(b);
+    mpz_clear(a2);
+    mpz_clear(a1);
+    FREE(q);
+    return min_p;
+}
 
-    r->stat_gen = (long *) MALLOC(sizeof(long)*r->prefix_capacity);
-    r->stat_can = (long *) MALLOC(sizeof(long)*r->prefix_capacity);
-    r->stat_out = (long *) MALLOC(sizeof(long)*r->prefix_capacity);
+struct selector_struct
+{
+    const char     *name;
+    select_func_t  func;
+};
 
-    r->initialized = 1;
+static const struct selector_struct selectors[] = {
+    { "default",    select_default },
+    { "smallest",   select_smallest },
+    { "occurrence", select_occurrence },
+    { "stabilizer", select_stabilizer },
+    { "lookahead",  select_lookahead } };
 
-    graph_t *g = NULL;
-    int i = 0;
-    for(; i < k; i++)
-        g = reducer_expand_prefix(r, i, r->prefix[i], g);
+#define NUM_SELECTORS ((int) (sizeof(selectors)/sizeof(selectors[0])))
 
-    if(g != NULL) {
-        fprintf(stderr, "graph [%d]:", i);
-        print_aut_order(stderr, g);
-        fprintf(stderr, "\n");
-        fprintf(stderr, "   orbits = [");
-        graph_print_orbits(stderr, g, r->v, r->var);
-        fprintf(stderr, "]\n");
+void reducer_set_select(reducer_t *r, const char *name)
+{
+    int s = 0;
+    while(s < NUM_SELECTORS && strcmp(selectors[s].name, name))
+        s++;
+    if(s == NUM_SELECTORS)
+        ERROR("unknown prefix selection strategy '%s'", name);
+    if(!strcmp(name, "occurrence") && !r->have_cnf)
+        ERROR("prefix selection strategy '%s' requires CNF input", name);
+    r->select = s;
+}
 
-        if(r->verbose) {
-            print_orbit_perms(stderr, g, r->v, r->var);
-            fprintf(stderr, "select = %d\n", orbit_select(g, r->v, r->var,
-                                                          k, r->prefix,
-                                                          k > 0 ?
-                                                          r->trav_ind[k-1] : 
-                                                          NULL));
-        }
-        r->last_prefix_g = g;
-    }
+/* Logs the selection of p at level k. */
 
-    fprintf(stderr, "init:");
-    pop_print_time("reducer_initialize");
-    fprintf(stderr, "\n");       
+static void select_log(reducer_t *r, graph_t *g, int k, int p)
+{
+    const int *start = graph_orbit_starts(g);
+    const int *cell_of = graph_orbit_cell_of(g);
+    int o = cell_of[p];
+    int len = start[o+1] - start[o];
+    LOG(LOG_INFO,
+        "select [%d]: %d by %s, orbit length = %d, "
+        "predicted branching = %ld",
+        k, p + 1, selectors[r->select].name, len, (long) r->r*len);
 }
 
+/* Selects the next prefix point with the configured strategy and
+ * logs the choice. The predicted branching factor is the number of 
+ * candidates generated for each assignment expanded at the new level,
+ * namely the number of values times the length of the orbit of the 
+ * selected point. */
 
-/******************************************************** Release a reducer. */
-
-void reducer_free(reducer_t *r)
+static int reducer_select(reducer_t *r, graph_t *g, int k)
+{
+    push_time();
+    int p = selectors[r->select].func(r, g, k);
+    select_log(r, g, k, p);
+    pop_print_time("select");
+    LOG(LOG_INFO, "\n");
+    return p;
+}
+
+/* Tests whether each value vertex has a unique color and no edge of the 
+ * base graph joins a value vertex to a vertex with a variable color. 
+ * Then the automorphisms of a graph with assignment edges fix the set of
+ * assigned variables, and hence embed into the group of the prefix graph. */
+
+static int assignment_separated(reducer_t *r)
+{
+    int n = r->n;
+    const int *lab = graph_lab(r->base);
+    const int *ptn = graph_ptn(r->base);
+    int *cell = (int *) MALLOC(sizeof(int)*n);
+    int *size = (int *) MALLOC(sizeof(int)*n);
+    int *q    = (int *) MALLOC(sizeof(int)*n);
+    int c = 0;
+    for(int i = 0; i < n; i++) {
+        cell[lab[i]] = c;
+        size[c] = 0;
+        q[c] = 0;
+        if(ptn[i] == 0)
+            c++;
+    }
+    for(int i = 0; i < n; i++)
+        size[cell[i]]++;
+    for(int i = 0; i < r->v; i++)
+        q[cell[r->var[i]]] = 1;
+    int sep = 1;
+    for(int i = 0; i < r->r; i++)
+        if(size[cell[r->val[i]]] != 1 || q[cell[r->val[i]]])
+            sep = 0;
+    long m = graph_num_edges(r->base);
+    for(long e = 0; sep && e < m; e++) {
+        int u, v;
+        graph_edge(r->base, e, &u, &v);
+        if((r->val_idx[u] >= 0 && q[cell[v]]) ||
+           (r->val_idx[v] >= 0 && q[cell[u]]))
+            sep = 0;
+    }
+    FREE(q);
+    FREE(size);
+    FREE(cell);
+    return sep;
+}
+
+/* Tests whether each generator of the automorphism group of the base graph 
+ * acts on the variables either trivially or as a transposition. Then the
+ * group acts on the variables as the direct product of the symmetric groups
+ * on the connected components (blocks) of the transpositions, and the orbits 
+ * of prefix assignments are characterized by the value counts in each block. 
+ * Records the blocks and the order of the kernel of the action, and returns
+ * the length of the longest block, or 0 if the test fails. */
+
+static int block_find(reducer_t *r)
+{
+    int n = r->n;
+    graph_t *g = r->base;
+
+    /* Join the points of each transposition (union-find in 'up'). */
+    int *up = (int *) MALLOC(sizeof(int)*n);
+    for(int i = 0; i < n; i++)
+        up[i] = i;
+    int ok = 1;
+    const int *a = NULL;
+    while((a = graph_aut_gen(g)) != NULL) {
+        if(!ok)
+            continue;
+        int moved = 0;
+        int u = -1;
+        for(int i = 0; i < r->v; i++) {
+            int x = r->var[i];
+            if(a[x] != x) {
+                moved++;
+                u = x;
+            }
+        }
+        if(moved == 0)
+            continue;
+        if(moved != 2 || a[a[u]] != u) {
+            ok = 0;
+            continue;
+        }
+        int x = u;
+        int y = a[u];
+        while(up[x] != x)
+            x = up[x];
+        while(up[y] != y)
+            y = up[y];
+        if(x != y)
+            up[x < y ? y : x] = x < y ? x : y;
+    }
+    if(!ok) {
+        FREE(up);
+        return 0;
+    }
+
+    /* Number the blocks in order of their least variable vertex. */
+    int nb = 0;
+    for(int u = 0; u < n; u++) {
+        if(r->var_idx[u] < 0)
+            continue;
+        int x = u;
+        while(up[x] != x)
+            x = up[x];
+        if(x == u) {
+            r->block_of[u] = nb;
+            r->block_len[nb++] = 0;
+        }
+        r->block_of[u] = r->block_of[x];
+        r->block_len[r->block_of[u]]++;
+    }
+    FREE(up);
+    r->num_blocks = nb;
+
+    mpz_t f;
+    mpz_init(f);
+    mpz_set_si(r->block_kern, 1L);
+    const int *ai = graph_aut_idx(g);
+    for(; *ai != 0; ai++)
+        mpz_mul_si(r->block_kern, r->block_kern, (long) *ai);
+    for(int b = 0; b < nb; b++) {
+        mpz_fac_ui(f, (unsigned long) r->block_len[b]);
+        mpz_divexact(r->block_kern, r->block_kern, f);
+    }
+    mpz_clear(f);
+
+    int max_len = 0;
+    for(int b = 0; b < nb; b++)
+        if(r->block_len[b] > max_len)
+            max_len = r->block_len[b];
+    return max_len;
+}
+
+/* Decides whether the block mode applies. The test labels the base graph,
+ * so it is logged and timed on a line of its own. */
+
+static int block_detect(reducer_t *r)
+{
+    for(int i = 0; i < r->n; i++)
+        r->block_of[i] = -1;
+    if(!r->separated)
+        return 0;
+    LOG(LOG_INFO, "blocks:");
+    push_time();
+    int max_len = block_find(r);
+    pop_print_time("block_detect");
+    LOG(LOG_INFO, "\n");
+    if(max_len < 2)
+        return 0;
+    LOG(LOG_INFO, "   %d [max length = %d]\n", r->num_blocks, max_len);
+    return 1;
+}
+
+/* Returns the least value admissible for the prefix variable at 'lvl'
+ * in block mode, that is, the largest value at an earlier variable in 
+ * the same block. */
+
+static int block_low(reducer_t *r, const int *vals, int lvl)
+{
+    int b = r->block_of[r->prefix[lvl]];
+    int low = 0;
+    for(int i = 0; i < lvl; i++)
+        if(r->block_of[r->prefix[i]] == b && vals[i] > low)
+            low = vals[i];
+    return low;
+}
+
+/* Returns the truncated order of the stabilizer of an assignment to the
+ * first 'size' prefix variables in block mode. */
+
+static int block_aut_trunc(reducer_t *r, const int *vals, int size)
+{
+    int d = r->r;
+    int nb = r->num_blocks;
+    int *cnt = r->block_cnt;
+    for(int i = 0; i < nb*(d+1); i++)
+        cnt[i] = 0;
+    for(int i = 0; i < size; i++) {
+        int b = r->block_of[r->prefix[i]];
+        cnt[b*(d+1) + vals[i]]++;
+        cnt[b*(d+1) + d]++;
+    }
+    mpz_t aut_order, f;
+    mpz_init(aut_order);
+    mpz_init(f);
+    mpz_set(aut_order, r->block_kern);
+    for(int b = 0; b < nb; b++) {
+        mpz_fac_ui(f, (unsigned long) (r->block_len[b] - cnt[b*(d+1) + d]));
+        mpz_mul(aut_order, aut_order, f);
+        for(int j = 0; j < d; j++) {
+            mpz_fac_ui(f, (unsigned long) cnt[b*(d+1) + j]);
+            mpz_mul(aut_order, aut_order, f);
+        }
+    }
+    int aut_trunc = 999999999;
+    if(mpz_cmp_si(aut_order, aut_trunc) < 0)
+        aut_trunc = (int) mpz_get_si(aut_order);
+    mpz_clear(f);
+    mpz_clear(aut_order);
+    return aut_trunc;
+}
+
+/* The base graph with the first k prefix variables fixed. */
+
+static graph_t *prefix_graph(reducer_t *r, int k)
+{
+    graph_t *g = graph_dup(r->base);
+    for(int j = 0; j < k; j++)
+        graph_add_edge(g, r->prefix[j], r->val[0]);
+    return g;
+}
+
+/* Checks the base graph against the variable and value lists. */
+
+static void check_base_orbits(reducer_t *r, graph_t *g)
+{
+    const int *p = graph_orbit_cells(g);
+    const int *start = graph_orbit_starts(g);
+    const int *cell_of = graph_orbit_cell_of(g);
+    int nc = graph_orbit_ncells(g);
+    int *q = (int *) MALLOC(sizeof(int)*r->n);
+    for(int j = 0; j < r->n; j++)
+        q[j] = 0;
+    for(int j = 0; j < r->v; j++)
+        q[r->var[j]] = 1;
+    for(int o = 0; o < nc; o++) {
+        int s = start[o];
+        for(int j = s+1; j < start[o+1]; j++)
+            if(q[p[j]] != q[p[s]])
+                ERROR("variable list is not a union of "
+                      "orbits of base graph "
+                      "(%d and %d have different orbits)",
+                      p[j] + 1, p[s] + 1);
+    }
+    FREE(q);
+    for(int s = 0; s < r->r; s++) {
+        int o = cell_of[r->val[s]];
+        if(start[o+1] - start[o] != 1)
+            ERROR("value vertex (%d) is not fixed by the automorphism "
+                  "group of the base graph", r->val[s] + 1);
+    }
+}
+
+/* Logs the graph g of the prefix before level k, and checks it at 0. */
+
+static void level_log_graph(reducer_t *r, int k, graph_t *g)
+{
+    if(LOGGING(LOG_INFO)) {
+        fprintf(stderr, "graph [%d]:", k);
+        print_aut_order(stderr, g);
+        fprintf(stderr, "\n");
+    }
+
+    if(k == 0)
+        check_base_orbits(r, g);
+
+    if(LOGGING(LOG_INFO)) {
+        fprintf(stderr, "   orbits = [");
+        graph_print_orbits(stderr, g, r->v, r->var);
+        fprintf(stderr, "]\n");
+    }
+    if(LOGGING(LOG_DEBUG)) {
+        print_orbit_perms(stderr, g, r->v, r->var);
+        fprintf(stderr, "select = %d\n", 
+                selectors[r->select].func(r, g, k));
+    }
+
+    LOG(LOG_INFO, "prefix[%d] = %d:", k + 1, r->prefix[k] + 1);
+}
+
+static void level_log_traversal(reducer_t *r, int k)
+{
+    LOG(LOG_INFO, "\n   traversal:");
+    if(LOGGING(LOG_INFO)) {
+        int *a = (int *) MALLOC(sizeof(int)*r->trav_sizes[k]);
+        for(int j = 0; j < r->trav_sizes[k]; j++)
+            a[j] = r->traversals[k][j][r->prefix[k]];
+        fprintf(stderr, " ");
+        print_int_array(stderr, r->trav_sizes[k], a);
+        FREE(a);
+    }
+    LOG(LOG_INFO, " [length = %d]\n", r->trav_sizes[k]);
+}
+
+/* The traversal at level k from the graph g of the prefix before it. */
+
+static void level_traversal(reducer_t *r, int k, graph_t *g)
+{
+    r->orbits[k] = bitset_alloc(r->n);
+    r->trav_ind[k] = bitset_alloc(r->n);
+    r->seed_min[k] = bitset_alloc(r->n);
+    r->trav_sizes[k] = traversal_prepare(r->traversals + k,
+                                         r->prefix[k],
+                                         g);
+    for(int j = 0; j < r->trav_sizes[k]; j++)
+        BITSET_ADD(r->trav_ind[k], r->traversals[k][j][r->prefix[k]]);
+}
+
+/* The orbit of the variable at level k from the graph h of the prefix 
+ * up to and including it. */
+
+static void level_orbits(reducer_t *r, int k, graph_t *h)
+{
+    for(int j = 0; j < r->n; j++)
+        if(graph_same_orbit(h, r->prefix[k], j))
+            BITSET_ADD(r->orbits[k], j);
+
+    /* With a unique candidate variable and a trivial group for the prefix
+     * graph, every candidate at this level is canonical and has a trivial
+     * automorphism group, so the candidate test can be skipped. */
+    r->trivial[k] = r->separated && 
+                    r->trav_sizes[k] == 1 &&
+                    graph_orbit_ncells(h) == r->n;
+}
+
+static graph_t *reducer_expand_prefix(reducer_t *r, int k, int p, 
+                                      graph_t *prev)
+{
+    if(!r->initialized)
+        ABORT("cannot expand an uninitialized prefix");
+    if(k + 1 >= r->prefix_capacity)
+        reducer_enlarge_prefix(r, 2*r->prefix_capacity+1);
+
+    push_time();
+    r->prefix[k] = p;
+    if(k > r->k)
+        ABORT("unsupported expansion");
+    if(r->k == k) {
+        r->stat_gen[k] = 0;
+        r->stat_can[k] = 0;
+        r->stat_out[k] = 0;
+        r->k = k+1;
+    }
+
+    graph_t *g = prev;
+    if(g == NULL)
+        g = prefix_graph(r, k);
+    level_log_graph(r, k, g);
+
+    push_time();
+    level_traversal(r, k, g);
+    pop_print_time("traversal");
+    graph_free(g);
+    level_log_traversal(r, k);
+
+    g = prefix_graph(r, k + 1);
+    level_orbits(r, k, g);
+
+    pop_print_time("prefix_total");
+    LOG(LOG_INFO, "\n");
+    log_flush();
+
+    return g;
+}
+
+/* Computes the levels 0,1,...,k-1 of a given prefix in windows of as many
+ * levels as there are threads, with a thread for each level, in two rounds
+ * so that no graph is used by two threads at once: first the graph of the
+ * prefix before each level and its traversal, and then the orbits at each
+ * level from the graph of the next one. The results are as with 
+ * reducer_expand_prefix() level by level. */
+
+typedef struct level_task_struct
+{
+    reducer_t *r;
+    int       k;
+    int       end;       /* The window ends before this level. */
+    int       round;
+    graph_t   **g;       /* The graphs of the prefixes before each level. */
+} level_task_t;
+
+static void *level_run(void *arg)
+{
+    level_task_t *t = (level_task_t *) arg;
+    reducer_t *r = t->r;
+    int k = t->k;
+    if(t->round == 0) {
+        if(t->g[k] == NULL)
+            t->g[k] = prefix_graph(r, k);
+        if(k < t->end)
+            level_traversal(r, k, t->g[k]);
+        else
+            graph_orbit_ncells(t->g[k]); /* Label for the next round. */
+    } else {
+        level_orbits(r, k, t->g[k+1]);
+    }
+    graph_cache_free();
+    return NULL;
+}
+
+static graph_t *reducer_expand_levels(reducer_t *r, int k)
+{
+    if(k >= r->prefix_capacity)
+        reducer_enlarge_prefix(r, 2*r->prefix_capacity+1);
+
+    push_time();
+    int w = r->threads;
+    graph_t **g = (graph_t **) MALLOC(sizeof(graph_t *)*(k+1));
+    for(int i = 0; i <= k; i++)
+        g[i] = NULL;
+    level_task_t *t = (level_task_t *) MALLOC(sizeof(level_task_t)*(w+1));
+    pthread_t *th = (pthread_t *) MALLOC(sizeof(pthread_t)*(w+1));
+    for(int a = 0; a < k; a += w) {
+        int b = a + w < k ? a + w : k;
+        for(int round = 0; round < 2; round++) {
+            int m = round == 0 ? b - a + 1 : b - a;
+            for(int i = 0; i < m; i++) {
+                t[i].r     = r;
+                t[i].k     = a + i;
+                t[i].end   = b;
+                t[i].round = round;
+                t[i].g     = g;
+                if(pthread_create(&th[i], NULL, level_run, &t[i]) != 0)
+                    ERROR("error creating a thread");
+            }
+            for(int i = 0; i < m; i++)
+                pthread_join(th[i], NULL);
+        }
+        for(int i = a; i < b; i++) {
+            level_log_graph(r, i, g[i]);
+            level_log_traversal(r, i);
+            LOG(LOG_INFO, "\n");
+            graph_free(g[i]);
+        }
+        log_flush();
+    }
+    graph_t *last = g[k];
+    FREE(th);
+    FREE(t);
+    FREE(g);
+    LOG(LOG_INFO, "levels [%d threads]:", w);
+    pop_print_time("reducer_expand_levels");
+    LOG(LOG_INFO, "\n");
+    return last;
+}
+
+/******************************************* Expanding the next level ahead. */
+
+/* 
+ * With more than one thread and the prefix selected as the search goes,
+ * a helper thread selects and expands the level after the last one as 
+ * soon as the last one is in place, on the graph of the prefix so far, 
+ * which the helper owns until it is joined. The search takes the level 
+ * over when it first needs it, waiting only if the helper is not yet 
+ * done. The helper neither logs nor touches the levels already in use,
+ * and the logs are written when the level is taken over, so the results
+ * and the logs are the same as without the helper.
+ */
+
+static void *spec_run(void *arg)
+{
+    reducer_t *r = (reducer_t *) arg;
+    int k = r->spec_k;
+    graph_t *g = r->spec_g;
+    int p = selectors[r->select].func(r, g, k);
+    r->prefix[k] = p;
+    level_traversal(r, k, g);
+    graph_add_edge(r->spec_h, p, r->val[0]);
+    level_orbits(r, k, r->spec_h);
+    graph_cache_free();
+    __atomic_store_n(&r->spec_ready, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Starts the helper on level k after the prefix graph g. */
+
+static void spec_start(reducer_t *r, int k, graph_t *g)
+{
+    if(r->threads < 2 || k >= r->target_length || g == NULL)
+        return;
+    if(k + 1 >= r->prefix_capacity)
+        reducer_enlarge_prefix(r, 2*r->prefix_capacity+1);
+    r->spec_k = k;
+    r->spec_ready = 0;
+    r->spec_g = g;
+    r->spec_h = prefix_graph(r, k);
+    if(pthread_create(&r->spec_thread, NULL, spec_run, r) != 0)
+        ERROR("error creating a thread");
+}
+
+/* Takes over level k from the helper and returns the prefix graph up to
+ * and including it, as reducer_expand_prefix() does. */
+
+static graph_t *spec_finish(reducer_t *r, int k)
+{
+    int ready = __atomic_load_n(&r->spec_ready, __ATOMIC_ACQUIRE);
+    pthread_join(r->spec_thread, NULL);
+    r->spec_k = -1;
+    LOG(LOG_DEBUG, "ahead [%d]: %s\n", k, ready ? "ready" : "waited");
+
+    graph_t *g = r->spec_g;
+    select_log(r, g, k, r->prefix[k]);
+    LOG(LOG_INFO, "\n");
+    r->stat_gen[k] = 0;
+    r->stat_can[k] = 0;
+    r->stat_out[k] = 0;
+    r->k = k+1;
+    level_log_graph(r, k, g);
+    graph_free(g);
+    level_log_traversal(r, k);
+    LOG(LOG_INFO, "\n");
+    log_flush();
+    return r->spec_h;
+}
+
+/* Discards the level ahead, if any; the prefix graph before it stays. */
+
+static void spec_cancel(reducer_t *r)
+{
+    if(r->spec_k < 0)
+        return;
+    pthread_join(r->spec_thread, NULL);
+    int k = r->spec_k;
+    traversal_release(r->trav_sizes[k], r->traversals[k]);
+    FREE(r->trav_ind[k]);
+    FREE(r->orbits[k]);
+    FREE(r->seed_min[k]);
+    graph_free(r->spec_h);
+    r->spec_k = -1;
+}
+
+/* Selects and expands level k after the prefix graph g, or takes it over
+ * from the helper, and starts the helper on the level after. */
+
+static graph_t *reducer_next_level(reducer_t *r, int k, graph_t *g)
+{
+    graph_t *h;
+    if(r->spec_k == k) {
+        h = spec_finish(r, k);
+    } else {
+        int p = reducer_select(r, g, k);
+        h = reducer_expand_prefix(r, k, p, g);
+    }
+    spec_start(r, k + 1, h);
+    return h;
+}
+
+static void reducer_initialize(reducer_t *r)
+{
+    if(r->initialized)
+        return;
+
+    int k = r->k;
+    if(k > r->prefix_capacity)
+        ABORT("prefix overrun at init");
+
+    push_time();
+
+    r->orbits = (bitset_t **) MALLOC(sizeof(bitset_t *)*r->prefix_capacity);
+    r->trav_sizes = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
+    r->trav_ind = (bitset_t **) MALLOC(sizeof(bitset_t *)*r->prefix_capacity);
+    r->traversals = (int ***) MALLOC(sizeof(int **)*r->prefix_capacity);
+    r->trivial = (int *) MALLOC(sizeof(int)*r->prefix_capacity);
+    r->separated = assignment_separated(r);
+    r->block_of = (int *) MALLOC(sizeof(int)*r->n);
+    r->block_len = (int *) MALLOC(sizeof(int)*r->v);
+    r->block_cnt = (int *) MALLOC(sizeof(int)*r->v*(r->r+1));
+    mpz_init(r->block_kern);
+    r->block = block_detect(r);
+
+    r->work = (int *) MALLOC(sizeof(int)*(2*r->prefix_capacity+1)
+                                        *(r->prefix_capacity+1));
+    r->seed_min = (bitset_t **) MALLOC(sizeof(bitset_t *)*r->prefix_capacity);
+    r->scratch = (int *) MALLOC(sizeof(int)*(2*r->prefix_capacity+2));
+    r->stack_top = 0; /* The stack is empty. */
+    r->cand_g = graph_alloc(r->n);
+    r->nu = (int *) MALLOC(sizeof(int)*r->n);
+
+
+    r->stat_gen = (long *) MALLOC(sizeof(long)*r->prefix_capacity);
+    r->stat_can = (long *) MALLOC(sizeof(long)*r->prefix_capacity);
+    r->stat_out = (long *) MALLOC(sizeof(long)*r->prefix_capacity);
+
+    r->initialized = 1;
+
+    graph_t *g = NULL;
+    int i = 0;
+    if(r->threads > 1 && k > 1) {
+        g = reducer_expand_levels(r, k);
+        i = k;
+    }
+    for(; i < k; i++)
+        g = reducer_expand_prefix(r, i, r->prefix[i], g);
+
+    if(g != NULL) {
+        if(LOGGING(LOG_INFO)) {
+            fprintf(stderr, "graph [%d]:", i);
+            print_aut_order(stderr, g);
+            fprintf(stderr, "\n");
+            fprintf(stderr, "   orbits = [");
+            graph_print_orbits(stderr, g, r->v, r->var);
+            fprintf(stderr, "]\n");
+        }
+        if(LOGGING(LOG_DEBUG)) {
+            print_orbit_perms(stderr, g, r->v, r->var);
+            fprintf(stderr, "select = %d\n", 
+                    selectors[r->select].func(r, g, k));
+        }
+        r->last_prefix_g = g;
+    }
+
+    LOG(LOG_INFO, "init:");
+    pop_print_time("reducer_initialize");
+    LOG(LOG_INFO, "\n");       
+    log_flush();
+
+    spec_start(r, k, r->last_prefix_g);
+}
+
+
+/******************************************************** Release a reducer. */
+
+void reducer_free(reducer_t *r)
 {
     if(r->initialized) {
+        spec_cancel(r);
         FREE(r->stat_out);
         FREE(r->stat_can);
         FREE(r->stat_gen);
         int k = r->k;       
+        FREE(r->nu);
+        graph_free(r->cand_g);
         FREE(r->scratch);
         FREE(r->work);
         for(int i = 0; i < k; i++) {
@@ -1314,6 +2433,11 @@ void reducer_free(reducer_t *r)
             FREE(r->seed_min[i]);
         }
         FREE(r->seed_min);
+        FREE(r->trivial);
+        FREE(r->block_cnt);
+        FREE(r->block_len);
+        FREE(r->block_of);
+        mpz_clear(r->block_kern);
         FREE(r->traversals);
         FREE(r->trav_ind);
         FREE(r->trav_sizes);
@@ -1322,10 +2446,19 @@ void reducer_free(reducer_t *r)
     if(r->last_prefix_g != NULL)
         graph_free(r->last_prefix_g);
 
-    if(r->have_cnf)
-        FREE(r->clauses);
+    if(r->have_cnf) {
+        if(r->clauses != NULL)
+            FREE(r->clauses);
+        FREE(r->occ);
+    }
 
     FREE(r->var_trans);
+    if(r->have_cnf) {
+        FREE(r->lit_str);
+        FREE(r->lit_off);
+    }
+    FREE(r->val_idx);
+    FREE(r->var_idx);
 
     FREE(r->prefix);
     FREE(r->asgn);
@@ -1341,6 +2474,8 @@ void reducer_free(reducer_t *r)
     FREE(r);
 }
 
+#ifndef REDUCE_LIBRARY
+
 /************************************* Print the configuration of a reducer. */
 
 void reducer_print(FILE *out, reducer_t *r)
@@ -1359,7 +2494,30 @@ void reducer_print(FILE *out, reducer_t *r)
         FPRINTF(out, "f %d\n", r->prefix[i] + 1);
 }
 
-void reducer_print_cnf(FILE *out, 
+/* Copies the clauses from the input in bulk, ending with a newline. */
+
+static void reducer_copy_clauses(outbuf_t *out, reducer_t *r)
+{
+    FILE *in = r->cnf_in;
+    if(fseek(in, r->cnf_start, SEEK_SET) != 0)
+        ERROR("error seeking input for passthrough");
+    char *buf = (char *) MALLOC(OUTBUF_SIZE);
+    long left = r->cnf_end - r->cnf_start;
+    char last = '\n';
+    while(left > 0) {
+        long l = left < OUTBUF_SIZE ? left : OUTBUF_SIZE;
+        if(fread(buf, 1, l, in) != (size_t) l)
+            ERROR("error reading input for passthrough");
+        outbuf_write(out, buf, l);
+        last = buf[l-1];
+        left -= l;
+    }
+    if(last != '\n')
+        outbuf_putc(out, '\n');
+    FREE(buf);
+}
+
+void reducer_print_cnf(outbuf_t *out, 
                        const char *fmt, 
                        int header_var_adjust, 
                        int header_clause_adjust,
@@ -1376,274 +2534,1953 @@ void reducer_print_cnf(FILE *out,
        header_clause_adjust < 0)
         do_header_counts = 0;
 
+    outbuf_puts(out, "p ");
+    outbuf_puts(out, fmt);
     if(do_header_counts) {
-        FPRINTF(out, 
-                "p %s %d %ld\n", 
-                fmt, 
-                nv + header_var_adjust, 
-                nc + header_clause_adjust);
-    } else {
-        FPRINTF(out, "p %s\n", fmt);
+        outbuf_putc(out, ' ');
+        outbuf_long(out, nv + header_var_adjust);
+        outbuf_putc(out, ' ');
+        outbuf_long(out, nc + header_clause_adjust);
+    }
+    outbuf_putc(out, '\n');
+
+    if(r->clauses == NULL) {
+        reducer_copy_clauses(out, r);
+        return;
     }
     
     long cursor = 0;
     int *buf = r->clauses;
     for(long c = 0; c < nc; c++) {
-        int first = 1;
         while(1) {
             int l = buf[cursor++];
-            FPRINTF(out, "%s%d", first ? "" : " ", l);
+            outbuf_long(out, l);
+            if(l == 0) {
+                outbuf_putc(out, '\n');
+                break;
+            }
+            outbuf_putc(out, ' ');
+        }
+    }
+}
+
+#endif
+
+/********************************* Get a prefix assignment from the reducer. */
+
+#define BEAT_NODES 4096 /* Generated nodes between heartbeat clock checks. */
+
+static unsigned long long probe_rand(reducer_t *r)
+{
+    r->rng ^= r->rng >> 12;
+    r->rng ^= r->rng << 25;
+    r->rng ^= r->rng >> 27;
+    return r->rng * 2685821657736338717ULL;
+}
+
+static int aut_order_trunc(graph_t *g)
+{
+    mpz_t aut_order;
+    mpz_init(aut_order);
+    mpz_set_si(aut_order, 1L);
+    const int *ai = graph_aut_idx(g);
+    while(*ai != 0) {
+        mpz_mul_si(aut_order, aut_order, (long) *ai);
+        ai++;
+    }
+    int aut_trunc = 999999999;
+    if(mpz_cmp_si(aut_order, aut_trunc) < 0)
+        aut_trunc = (int) mpz_get_si(aut_order);
+    mpz_clear(aut_order);
+    return aut_trunc;
+}
+
+/* Returns the fraction of the children of the frame at level lvl
+ * that have been generated, and their number in c. Only the traversal
+ * entries that hit seed-orbit minima are visited. */
+
+static double frame_progress(reducer_t *r, int lvl, const int *frame, 
+                             long *c)
+{
+    int d = r->r;
+    int size = lvl + 1;
+    const int *vars = frame;
+    const int *vals = frame + size;
+    *c = d;
+    if(r->block)
+        return (double) vals[lvl]/d;
+    int m = 0;
+    int done = 0;
+    for(int j = 0; j < r->trav_sizes[lvl]; j++) {
+        int w = r->traversals[lvl][j][r->prefix[lvl]];
+        if(!BITSET_TEST(r->seed_min[lvl], w))
+            continue;
+        for(int i = 0; i < size; i++)
+            if(vars[i] == w)
+                done = m*d + vals[i];
+        m++;
+    }
+    *c = (long) m*d;
+    return m > 0 ? (double) done/((double) m*d) : 0.0;
+}
+
+/* Reports progress if the heartbeat interval has elapsed. The work stack
+ * holds one frame for each level from the bottom up, so their positions
+ * give the fraction of the search done, assuming that the children of 
+ * each frame have subtrees of equal size. */
+
+static void reducer_heartbeat(reducer_t *r)
+{
+    r->beat_countdown = BEAT_NODES;
+    time_t now = time(NULL);
+    if(r->probe || now - r->beat_last < r->beat)
+        return;
+
+    long gen = 0;
+    long out = 0;
+    for(int l = 0; l < r->k; l++) {
+        gen += r->stat_gen[l];
+        out += r->stat_out[l];
+    }
+    int depth = r->work[r->stack_top - 1];
+    double f[2] = { 0.0, 0.0 };
+    double done = 0.0;
+    double scale = 1.0;
+    int *frame = r->work;
+    for(int l = 0; l < depth; l++) {
+        long c;
+        double x = frame_progress(r, l, frame, &c);
+        if(l < 2)
+            f[l] = x;
+        /* The current child is under way unless this is the top frame. */
+        done += scale*(l < depth - 1 ? x - 1.0/c : x);
+        scale /= c;
+        frame += 2*(l+1) + 1;
+    }
+    double elapsed = difftime(now, r->beat_start);
+    double rate = (gen - r->beat_last_gen)/difftime(now, r->beat_last);
+    double eta = done > 0.0 ? elapsed*(1.0 - done)/done : 0.0;
+    r->beat_last = now;
+    r->beat_last_gen = gen;
+
+    FILE *status = stderr;
+    if(r->status_file != NULL &&
+       (status = fopen(r->status_file, "w")) == NULL)
+        ERROR("error opening \"%s\" for status", r->status_file);
+    fprintf(status, 
+            "c heartbeat: cubes = %ld, nodes = %ld (%.0f/s), depth = %d, "
+            "level 1 = %.1f%%, level 2 = %.1f%%, done = %.1f%%, "
+            "eta = %.0fs\n",
+            out, gen, rate, depth, 
+            100.0*f[0], 100.0*f[1], 100.0*done, eta);
+    if(status == stderr)
+        log_flush();
+    else if(fclose(status) != 0)
+        ERROR("error closing status file");
+}
+
+#ifndef REDUCE_LIBRARY
+
+void reducer_set_heartbeat(reducer_t *r, long beat, const char *status_file)
+{
+    if(beat < 1)
+        ERROR("bad heartbeat interval (%ld)", beat);
+    r->beat = beat;
+    r->status_file = status_file;
+}
+
+#endif
+
+static const int *reducer_get_prefix_assignment(reducer_t *r)
+{
+    int n = r->n;
+    int k = r->k;
+    int d = r->r;
+
+    if(r->target_length == 0)
+        return NULL;
+        
+    if(r->stack_top == 0) {
+        if(k == 0) {
+            /* Initialize the prefix. */            
+            int p = reducer_select(r, r->base, k);
+            r->last_prefix_g = reducer_expand_prefix(r, k, p, NULL);
+            spec_start(r, k + 1, r->last_prefix_g);
+            k++;
+        }
+
+        /* Initialize minimum indicators for orbits of the base graph. */
+        orbit_min_ind(r->base, r->v, r->var, NULL, r->seed_min[0]);
+
+        /* Initialize the iterator work stack. */
+        /* Caveat: should initialize the r->a assigned variables here. */
+        /* First variable is minimum in its base-automorphism orbit. */
+
+        if(r->block) {
+            /* Block mode visits the prefix variables in order. */
+            for(int i = 0; i < n; i++)
+                r->nu[i] = i;
+            r->work[0] = r->prefix[0];
+        } else {
+            int p = 0;
+            for(; p < r->trav_sizes[0]; p++) {
+                if(BITSET_TEST(r->seed_min[0], 
+                               r->traversals[0][p][r->prefix[0]])) {
+                    r->work[0] = r->traversals[0][p][r->prefix[0]];
+                    break;
+                }
+            }
+            if(p == r->trav_sizes[0])
+                ABORT("no minimum found for base orbit");
+        }
+        r->work[1] = 0;
+        r->work[2] = 1;
+        r->stack_top = 3;
+
+        for(int i = 0; i < k; i++) {
+            r->stat_out[i] = 0;
+            r->stat_gen[i] = 0;
+            r->stat_can[i] = 0;
+        }
+        r->beat_countdown = BEAT_NODES;
+        r->beat_start = r->beat_last = time(NULL);
+        r->beat_last_gen = 0;
+    }
+    while(r->stack_top > 0) {
+        /* Pop the stack top. */
+        int size = r->work[r->stack_top - 1];
+        int *vars = r->work + r->stack_top - 1 - 2*size;
+        int *vals = r->work + r->stack_top - 1 - size;
+        r->stack_top = r->stack_top - (2*size+1);
+
+        /* Find the current variable. */
+        int lvl = size - 1;
+        int current = -1;
+        int current_idx = -1;
+        if(r->block) {
+            current = 0;
+            current_idx = lvl;
+        }
+        for(int j = 0; !r->block && j < r->trav_sizes[lvl]; j++) {
+            for(int i = 0; i < size; i++) {             
+                if(vars[i] == r->traversals[lvl][j][r->prefix[lvl]]) {
+                    current = j;
+                    current_idx = i;
+                }
+            }
+        }
+        if(current == -1)
+            ABORT("no current variable");
+
+        if(size >= r->prefix_capacity)
+            ABORT("prefix overrun");
+
+        int current_val = vals[current_idx];
+        if(current_val < d) {
+            r->stat_gen[lvl]++;
+
+            /* Save next value, relying on existing stack contents. */
+            vals[current_idx]++;
+            r->stack_top = r->stack_top + (2*size+1);
+
+            if(r->beat > 0 && --r->beat_countdown == 0)
+                reducer_heartbeat(r);
+            
+            /* Process stack top. */
+            int *nu = r->nu;
+            int trivial = r->trivial[lvl];
+            graph_t *g = r->cand_g;
+            int accept = 1;
+            if(r->block) {
+                /* Values are nondecreasing in each block. */
+                accept = current_val >= block_low(r, vals, lvl);
+            } else {
+                for(int i = 0; i < n; i++)
+                    nu[r->traversals[lvl][current][i]] = i;
+                if(nu[vars[current_idx]] != r->prefix[lvl])
+                    ABORT("bad nu");
+            }
+            if(!r->block && !trivial) {
+                graph_copy(g, r->base);
+                for(int i = 0; i < size; i++) {
+                    if(i != current_idx) {
+                        graph_add_edge(g, vars[i], r->val[vals[i]]);
+                    } else {
+                        graph_add_edge(g, vars[i], r->val[current_val]);
+                    }
+                }
+                const int *lab = graph_can_lab(g);
+                int qlab = -1;
+                int t = 0;          
+                for(; t < n; t++) {
+                    qlab = lab[t];
+                    if(BITSET_TEST(r->orbits[lvl], nu[qlab]))
+                        break;
+                }
+                if(t == n)
+                    ABORT("bad qlab");
+                accept = graph_same_orbit(g, qlab, vars[current_idx]);
+            }
+            if(accept) {
+                /* Top was accepted by isomorph rejection. */
+                r->stat_can[lvl]++;
+                
+                /* Normalize top to scratch. */
+                r->scratch[0] = size;
+                int *norm_vars = r->scratch + 1;
+                int *norm_vals = r->scratch + 1 + size;
+                for(int i = 0; i < size; i++) {
+                    norm_vars[i] = nu[vars[i]];
+                    if(i != current_idx) {
+                        norm_vals[i] = vals[i];
+                    } else {
+                        norm_vals[i] = current_val;
+                    }
+                }
+                int aut;
+                if(r->block)
+                    aut = block_aut_trunc(r, norm_vals, size);
+                else
+                    aut = trivial ? 1 : aut_order_trunc(g);
+                r->scratch[2*size+1] = aut;
+                if(size == r->target_length || aut <= r->t) {
+                    for(int i = 0; i < size; i++)
+                        norm_vals[i] = r->val[norm_vals[i]];
+                    /* Report to caller. */
+                    r->stat_out[lvl]++;
+                    return r->scratch;
+                } else {
+                    /* Expand. */
+                    if(size + 1 > k) {
+                        /* Expand prefix. */
+                        r->last_prefix_g = 
+                            reducer_next_level(r, k, r->last_prefix_g);
+                        k++;
+                        /* Reset pointers to potentially new scratch. */
+                        norm_vars = r->scratch + 1;
+                        norm_vals = r->scratch + 1 + size;
+                    }
+                    if(r->probe) {
+                        /* Keep one child uniformly at random above 
+                         * the stack top until the frame is done. */
+                        long c = r->stat_can[lvl] - r->stat_out[lvl];
+                        if(probe_rand(r) % c != 0)
+                            continue;
+                    }
+                    int *exp_vars = r->work + r->stack_top;
+                    int *exp_vals = r->work + r->stack_top + (size + 1);
+                    r->work[r->stack_top + 2*(size+1)] = size + 1;
+                    if(!r->probe)
+                        r->stack_top = r->stack_top + 2*(size+1) + 1;
+                    
+                    for(int i = 0; i < size; i++) {
+                        exp_vars[i] = norm_vars[i];
+                        exp_vals[i] = norm_vals[i];
+                    }
+
+                    if(r->block) {
+                        exp_vars[size] = r->prefix[size];
+                        exp_vals[size] = 0;
+                        continue;
+                    }
+
+                    /* Save minima of (normalised) automorphism orbits. */
+                    if(trivial)
+                        orbit_all_ind(n, r->v, r->var, r->seed_min[lvl+1]);
+                    else
+                        orbit_min_ind(g, r->v, r->var, nu, 
+                                      r->seed_min[lvl+1]);
+
+                    /* First var is minimum in its seed-automorphism orbit. */
+                    int s = 0;
+                    for(; s < r->trav_sizes[lvl+1]; s++) {
+                        int w = r->traversals[lvl+1][s][r->prefix[lvl+1]];
+                        if(BITSET_TEST(r->seed_min[lvl+1], w)) {
+                            exp_vars[size] = w;
+                            break;
+                        }
+                    }
+                    if(s == r->trav_sizes[lvl+1])
+                        ABORT("no minimum found in extending orbit");
+                    exp_vals[size] = 0;
+                }
+            }
+        } else {
+            /* Proceed to the next variable, if any. */
+            /* Next variable must be minimum in its seed-automorphism orbit. */
+            /* Again rely on existing stack contents. */          
+            for(; !r->block && current + 1 < r->trav_sizes[lvl]; current++) {
+                if(BITSET_TEST(r->seed_min[lvl],
+                               r->traversals[lvl][current+1][r->prefix[lvl]])) {
+                    vars[current_idx] = 
+                        r->traversals[lvl][current+1][r->prefix[lvl]];
+                    vals[current_idx] = 0;
+                    r->stack_top = r->stack_top + 2*size + 1;
+                    break;
+                }               
+            }
+            if(r->probe && 
+               r->work + r->stack_top == vars &&
+               r->stat_can[lvl] > r->stat_out[lvl]) {
+                /* Frame done, descend to the kept child. */
+                for(int i = 0; i < 2*(size+1)+1; i++)
+                    vars[i] = vars[2*size+1+i];
+                r->stack_top = r->stack_top + 2*(size+1) + 1;
+            }
+        }
+    }
+    if(r->stack_top < 0)
+        ABORT("work stack out of balance");
+    /* Work done. */
+
+    return NULL;
+}
+
+#ifndef REDUCE_LIBRARY
+
+/************************ Estimate the size of the search by random probes. */
+
+/* Runs Knuth-style probes from the root of the search, each descending
+ * through a uniformly random expanded child at every level, with the same
+ * canonicity test as the enumeration. The counts at each level, weighted 
+ * by the product of the branching factors above, are unbiased estimates
+ * of the counts of a full run. Reports the estimates with 95% confidence 
+ * intervals, and predicts the run time from the probe rate. */
+
+void reducer_estimate(reducer_t *r, long probes)
+{
+    if(probes < 1)
+        ERROR("bad number of probes (%ld)", probes);
+
+    int m = r->v + 1;
+    double *sum = (double *) MALLOC(sizeof(double)*6*(m+1));
+    double *sum2 = sum + 3*(m+1);
+    for(int i = 0; i < 6*(m+1); i++)
+        sum[i] = 0.0;
+    long probe_gen = 0;
+
+    clock_t start = clock();
+    r->probe = 1;
+    r->rng = 0x9E3779B97F4A7C15ULL;
+    for(long s = 0; s < probes; s++) {
+        while(reducer_get_prefix_assignment(r) != NULL)
+            ;
+        double w = 1.0;
+        double total[3] = { 0.0, 0.0, 0.0 };
+        for(int l = 0; l < r->k && w > 0.0; l++) {
+            double x[3] = { w*r->stat_gen[l], 
+                            w*r->stat_can[l], 
+                            w*r->stat_out[l] };
+            for(int j = 0; j < 3; j++) {
+                sum[3*l+j] += x[j];
+                sum2[3*l+j] += x[j]*x[j];
+                total[j] += x[j];
+            }
+            probe_gen += r->stat_gen[l];
+            w *= (double) (r->stat_can[l] - r->stat_out[l]);
+        }
+        for(int j = 0; j < 3; j++) {
+            sum[3*m+j] += total[j];
+            sum2[3*m+j] += total[j]*total[j];
+        }
+    }
+    r->probe = 0;
+    double secs = ((double) (clock() - start))/CLOCKS_PER_SEC;
+
+    /* Mean and half-width of the 95% confidence interval. */
+    for(int i = 0; i < 3*(m+1); i++) {
+        double mean = sum[i]/probes;
+        double var = probes > 1 ? 
+                     (sum2[i] - probes*mean*mean)/(probes - 1) : 0.0;
+        sum[i] = mean;
+        sum2[i] = var > 0.0 ? 1.96*sqrt(var/probes) : 0.0;
+    }
+
+    fprintf(stderr, 
+            "c %7s %14s %10s %14s %10s %14s %10s\n",
+            "Size",
+            "Generated", "+-",
+            "Canonical", "+-",
+            "Output", "+-");
+    for(int l = 0; l < r->k; l++)
+        fprintf(stderr, 
+                "c %7d %14.0f %10.0f %14.0f %10.0f %14.0f %10.0f\n", 
+                l+1, 
+                sum[3*l+0], sum2[3*l+0],
+                sum[3*l+1], sum2[3*l+1],
+                sum[3*l+2], sum2[3*l+2]);
+    double rate = probe_gen > 0 ? secs/probe_gen : 0.0;
+    fprintf(stderr, 
+            "c estimate: probes = %ld, cubes = %.0f +- %.0f, "
+            "time = %.2fs +- %.2fs\n",
+            probes,
+            sum[3*m+2], sum2[3*m+2],
+            rate*sum[3*m+0], rate*sum2[3*m+0]);
+    FREE(sum);
+}
+
+/********************** Print a prefix assignment obtained from the reducer. */
+
+void reducer_print_assignment(outbuf_t *out, reducer_t *r, const int *a)
+{
+    int size = a[0];
+    const int *vars = a + 1;
+    const int *vals = a + 1 + size;
+    for(int i = 0; i < size; i++) {
+        int j  = r->var_idx[vars[i]];
+        int jj = r->val_idx[vals[i]];
+        if(j == -1 || jj == -1)
+            ABORT("no data for assignment");
+        outbuf_puts(out, r->var_legend[j]);
+        outbuf_puts(out, " -> ");
+        outbuf_puts(out, r->val_legend[jj]);
+        outbuf_puts(out, i == size-1 ? "\n" : ", ");
+    }
+}
+
+#endif
+
+/************************* Get a literal of an assignment a in the CNF mode. */
+
+static int reducer_bool_literal(reducer_t *r, const int *a, int i)
+{
+    int l = 1 + r->var_trans[a[1+i]];
+    return a[1+a[0]+i] == r->val[0] ? -l : l;
+}
+
+/******************************************************** Library interface. */
+
+/* Returns a copy of the nc zero-terminated clauses and their length. */
+
+static int *clauses_dup(int nv, long nc, const int *clauses, long *len)
+{
+    long l = 0;
+    for(long c = 0; c < nc; c++, l++) {
+        for(; clauses[l] != 0; l++)
+            if(abs(clauses[l]) > nv)
+                ERROR("bad literal %d in CNF input (n = %d)", clauses[l], nv);
+    }
+    int *buf = (int *) MALLOC(sizeof(int)*(l+1));
+    for(long u = 0; u < l; u++)
+        buf[u] = clauses[u];
+    *len = l;
+    return buf;
+}
+
+static char *legend_number(int x)
+{
+    char temp[24];
+    sprintf(temp, "%d", x);
+    char *s = (char *) MALLOC(sizeof(char)*(strlen(temp)+1));
+    strcpy(s, temp);
+    return s;
+}
+
+static char *legend_string(const char *t)
+{
+    char *s = (char *) MALLOC(sizeof(char)*(strlen(t)+1));
+    strcpy(s, t);
+    return s;
+}
+
+static void reducer_check_unused(reducer_t *r)
+{
+    if(r->initialized)
+        ERROR("reducer must be configured before its first cube");
+}
+
+reducer_t *reducer_alloc_cnf(int nv, long nc, const int *clauses, int basic)
+{
+    if(nv < 1)
+        ERROR("bad number-of-variables parameter (n = %d) in CNF", nv);
+    if(nc < 0)
+        ERROR("bad number-of-clauses parameter (c = %ld) in CNF", nc);
+    reducer_t *r = reducer_alloc();
+    long len;
+    int *buf = clauses_dup(nv, nc, clauses, &len);
+    reducer_set_clauses(r, nv, nc, buf, len);
+    reducer_cnf_symmetry(r, basic);
+    reducer_index(r);
+    reducer_translate(r);
+    return r;
+}
+
+reducer_t *reducer_alloc_graph(graph_t *g, const int *colors, 
+                               int v, const int *var, 
+                               int d, const int *val)
+{
+    int n = graph_order(g);
+    if(v < 1)
+        ERROR("bad variable parameter v = %d", v);
+    if(d < 1)
+        ERROR("bad value parameter r = %d", d);
+    reducer_t *r = reducer_alloc();
+    if(colors != NULL) {
+        int *c = (int *) MALLOC(sizeof(int)*n);
+        for(int u = 0; u < n; u++)
+            c[u] = colors[u];
+        color_graph(g, c);
+        FREE(c);
+    }
+    r->n = n;
+    r->base = g;
+
+    /* Vertices are named by their numbers as in the input format. */
+    r->v = v;
+    r->var = (int *) MALLOC(sizeof(int)*v);
+    r->var_legend = (char **) MALLOC(sizeof(char *)*v);
+    for(int i = 0; i < v; i++) {
+        if(var[i] < 0 || var[i] >= n)
+            ERROR("bad variable identifier u = %d", var[i] + 1);
+        r->var[i] = var[i];
+        r->var_legend[i] = legend_number(var[i] + 1);
+    }
+    r->r = d;
+    r->val = (int *) MALLOC(sizeof(int)*d);
+    r->val_legend = (char **) MALLOC(sizeof(char *)*d);
+    for(int i = 0; i < d; i++) {
+        if(val[i] < 0 || val[i] >= n)
+            ERROR("bad value identifier u = %d", val[i] + 1);
+        r->val[i] = val[i];
+        r->val_legend[i] = legend_number(val[i] + 1);
+    }
+    reducer_index(r);
+    reducer_translate(r);
+    return r;
+}
+
+void reducer_set_cnf(reducer_t *r, int nv, long nc, 
+                     const int *clauses, const int *var_cnf)
+{
+    reducer_check_unused(r);
+    if(r->have_cnf)
+        ERROR("reducer already has CNF");
+    if(nv < 1)
+        ERROR("bad number-of-variables parameter (n = %d) in CNF", nv);
+    if(nc < 0)
+        ERROR("bad number-of-clauses parameter (c = %ld) in CNF", nc);
+    if(r->r != 2)
+        ERROR("value range does not consist of 'false' and 'true'");
+    long len;
+    int *buf = clauses_dup(nv, nc, clauses, &len);
+    reducer_set_clauses(r, nv, nc, buf, len);
+    for(int i = 0; i < r->v; i++) {
+        FREE(r->var_legend[i]);
+        r->var_legend[i] = legend_number(var_cnf[i]);
+    }
+    for(int i = 0; i < 2; i++) {
+        FREE(r->val_legend[i]);
+        r->val_legend[i] = legend_string(i == 0 ? "false" : "true");
+    }
+    FREE(r->var_trans);
+    reducer_translate(r);
+}
+
+void reducer_set_prefix(reducer_t *r, int k, const int *p)
+{
+    reducer_check_unused(r);
+    if(k < 0)
+        ERROR("bad prefix parameters k = %d", k);
+    reducer_alloc_prefix(r, k > 0 ? k : 1);
+    r->k = k;
+    r->a = 0;
+    for(int i = 0; i < k; i++)
+        r->prefix[i] = p[i];
+    reducer_check_prefix(r);
+    if(r->target_length < k)
+        r->target_length = k;
+}
+
+void reducer_set_length(reducer_t *r, int length)
+{
+    reducer_check_unused(r);
+    if(r->k > length)
+        ERROR("length of given prefix exceeds given target length for prefix");
+    r->target_length = length;
+}
+
+void reducer_set_threshold(reducer_t *r, long t)
+{
+    reducer_check_unused(r);
+    if(t < 0)
+        ERROR("bad threshold t = %ld", t);
+    r->t = t;
+}
+
+void reducer_set_threads(reducer_t *r, int threads)
+{
+    reducer_check_unused(r);
+    if(threads < 1)
+        ERROR("bad number of threads (%d)", threads);
+    r->threads = threads;
+}
+
+int reducer_cube_capacity(reducer_t *r)
+{
+    return 2*(r->target_length > r->k ? r->target_length : r->k);
+}
+
+int reducer_next_cube(reducer_t *r, int *d, int *cube, int *aut)
+{
+    if(r->exhausted)
+        return 0;
+    reducer_initialize(r);
+    const int *a = reducer_get_prefix_assignment(r);
+    if(a == NULL) {
+        /* The search would start over on the next call. */
+        r->exhausted = 1;
+        return 0;
+    }
+    int size = a[0];
+    if(r->have_cnf) {
+        for(int i = 0; i < size; i++)
+            cube[i] = reducer_bool_literal(r, a, i);
+    } else {
+        for(int i = 0; i < 2*size; i++)
+            cube[i] = a[i+1];
+    }
+    *d = size;
+    *aut = a[2*size+1];
+    return 1;
+}
+
+long reducer_for_each_cube(reducer_t *r, reducer_cube_func_t f, void *ctx)
+{
+    int *cube = (int *) MALLOC(sizeof(int)*(reducer_cube_capacity(r)+1));
+    long count = 0;
+    int d, aut;
+    while(reducer_next_cube(r, &d, cube, &aut)) {
+        count++;
+        if(f(ctx, d, cube, aut))
+            break;
+    }
+    FREE(cube);
+    return count;
+}
+
+#ifndef REDUCE_LIBRARY
+
+/************************************************* Asynchronous cube output. */
+
+/* In the streaming output formats, the cubes are passed through a ring
+ * to a writer thread that formats and writes them, so that the search 
+ * does not wait on the output unless the ring fills up. A record is 
+ * [d, x_1, ..., x_d, aut] with the literals x_i in the CNF formats, and 
+ * [d, vars, vals, aut] as in reducer_get_prefix_assignment() otherwise. */
+
+#define CUBE_RING_SIZE (1L << 20)
+
+#define CUBES_TEXT   0
+#define CUBES_ICNF   1
+#define CUBES_BINARY 2
+
+static void reducer_put_literal(outbuf_t *out, reducer_t *r, int l)
+{
+    const char *s = r->lit_str + r->lit_off[l > 0 ? l - 1 : -l - 1];
+    outbuf_puts(out, l > 0 ? s + 1 : s);
+}
+
+typedef struct cube_writer_struct
+{
+    reducer_t *r;
+    ring_t    *ring;
+    outbuf_t  *out;
+    int        format;
+    pthread_t  thread;
+} cube_writer_t;
+
+static void *cube_writer_run(void *arg)
+{
+    cube_writer_t *w = (cube_writer_t *) arg;
+    long count = 0;
+    int n;
+    int *c;
+    while(1) {
+        /* Pass the cubes on whenever the search has no more for now. */
+        if(ring_empty(w->ring)) {
+            outbuf_flush(w->out);
+            if(fflush(w->out->out) != 0)
+                ERROR("file error writing output");
+        }
+        if((c = ring_next(w->ring, &n)) == NULL)
+            break;
+        int d = c[0];
+        switch(w->format) {
+        case CUBES_BINARY:
+            cube_write(w->out, d, c + 1, c[d+1]);
+            break;
+        case CUBES_ICNF:
+            outbuf_puts(w->out, "a");
+            for(int i = 0; i < d; i++) {
+                outbuf_putc(w->out, ' ');
+                reducer_put_literal(w->out, w->r, c[i+1]);
+            }
+            outbuf_puts(w->out, " 0\n");
+            break;
+        default:
+            count++;
+            outbuf_long(w->out, count);
+            outbuf_puts(w->out, ": [");
+            outbuf_long(w->out, c[2*d+1]);
+            outbuf_puts(w->out, "] ");
+            reducer_print_assignment(w->out, w->r, c);
+            break;
+        }
+        ring_release(w->ring);
+    }
+    return NULL;
+}
+
+static cube_writer_t *cube_writer_start(reducer_t *r, outbuf_t *out, 
+                                        int format)
+{
+    cube_writer_t *w = (cube_writer_t *) MALLOC(sizeof(cube_writer_t));
+    w->r      = r;
+    w->ring   = ring_alloc(CUBE_RING_SIZE);
+    w->out    = out;
+    w->format = format;
+    if(pthread_create(&w->thread, NULL, cube_writer_run, w) != 0)
+        ERROR("error creating the output thread");
+    return w;
+}
+
+/* Passes the last assignment a to the writer. */
+
+static void cube_writer_put(cube_writer_t *w, const int *a)
+{
+    int d = a[0];
+    int *c;
+    if(w->format == CUBES_TEXT) {
+        c = ring_reserve(w->ring, 2*d + 2);
+        memcpy(c, a, sizeof(int)*(2*d + 2));
+    } else {
+        c = ring_reserve(w->ring, d + 2);
+        c[0] = d;
+        for(int i = 0; i < d; i++)
+            c[i+1] = reducer_bool_literal(w->r, a, i);
+        c[d+1] = a[2*d+1];
+    }
+    ring_commit(w->ring);
+}
+
+/* Waits for the writer to output the remaining cubes. */
+
+static void cube_writer_finish(cube_writer_t *w)
+{
+    ring_close(w->ring);
+    pthread_join(w->thread, NULL);
+    ring_free(w->ring);
+    FREE(w);
+}
+
+/************************************************ Solving cubes with IPASIR. */
+
+#ifdef HAVE_IPASIR
+
+/* Loads the clauses into an incremental solver once, and then solves 
+ * under each cube as assumptions until one of them is satisfiable. */
+
+static void reducer_solve(outbuf_t *out, reducer_t *r)
+{
+    if(r->clauses == NULL)
+        ERROR("solving needs the clauses in memory (not with passthrough)");
+    void *s = ipasir_init();
+    LOG(LOG_INFO, "solver: %s\n", ipasir_signature());
+    const int *c = r->clauses;
+    for(long i = 0; i < r->nc; i++) {
+        do {
+            ipasir_add(s, *c);
+        } while(*c++ != 0);
+    }
+
+    long count = 0;
+    int result = 20;
+    double total = 0.0;
+    const int *a = NULL;
+    while(result == 20 && (a = reducer_get_prefix_assignment(r)) != NULL) {
+        count++;
+        for(int i = 0; i < a[0]; i++)
+            ipasir_assume(s, reducer_bool_literal(r, a, i));
+        struct timespec start, stop;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        result = ipasir_solve(s);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        double ms = 1000.0*(stop.tv_sec - start.tv_sec) + 
+                    (stop.tv_nsec - start.tv_nsec)/1000000.0;
+        total += ms;
+        char line[64];
+        sprintf(line, " %s %.2fms\n", 
+                result == 10 ? "SAT" : result == 20 ? "UNSAT" : "UNKNOWN", ms);
+        outbuf_puts(out, "c cube ");
+        outbuf_long(out, count);
+        outbuf_puts(out, line);
+    }
+
+    if(result == 10) {
+        outbuf_puts(out, "s SATISFIABLE\n");
+        for(int x = 1; x <= r->nv; x++) {
+            int l = ipasir_val(s, x);
+            if((x - 1) % 10 == 0)
+                outbuf_putc(out, 'v');
+            outbuf_putc(out, ' ');
+            outbuf_long(out, l == 0 ? x : l);
+            if(x % 10 == 0 && x < r->nv)
+                outbuf_putc(out, '\n');
+        }
+        outbuf_puts(out, " 0\n");
+    } else {
+        outbuf_puts(out, result == 20 ? "s UNSATISFIABLE\n" 
+                                      : "s UNKNOWN\n");
+    }
+    LOG(LOG_INFO, "solve: cubes = %ld, time = %.2fms\n", count, total);
+    ipasir_release(s);
+}
+
+#endif
+
+/*************************************************************** Batch mode. */
+
+/* Instances are parsed in turn by the main thread and reduced by a pool of
+ * workers, each of which keeps its labeling cache from one instance to the
+ * next. A worker formats the cubes of an instance in memory and frees the
+ * instance; the text is written after a line 'c instance <tag> <cubes>',
+ * in the order of the input. Text done ahead of its turn is held back, and
+ * the main thread waits while the held back instances would exceed the
+ * reorder window. */
+
+#define BATCH_QUEUE  64 /* Parsed instances waiting for a worker. */
+#define BATCH_WINDOW 64 /* Instances ahead of the next one to write. */
+
+typedef struct batch_job_struct
+{
+    reducer_t *r;
+    char      *tag;
+    long       seq;
+} batch_job_t;
+
+typedef struct batch_done_struct
+{
+    char                     *tag;
+    long                      seq;
+    long                      count;
+    char                     *text;
+    size_t                    size;
+    struct batch_done_struct *next;
+} batch_done_t;
+
+typedef struct batch_struct
+{
+    batch_job_t     queue[BATCH_QUEUE];
+    int             head;
+    int             len;
+    int             closed;
+    pthread_mutex_t lock;
+    pthread_cond_t  nonempty;
+    pthread_cond_t  nonfull;
+    pthread_mutex_t out_lock;
+    pthread_cond_t  turn;   /* Signals that 'next' has advanced. */
+    outbuf_t        *out;
+    long            cubes;
+    long            next;   /* The next instance to write. */
+    batch_done_t    *done;  /* Instances held back, in input order. */
+} batch_t;
+
+static void batch_put(batch_t *b, reducer_t *r, char *tag, long seq)
+{
+    pthread_mutex_lock(&b->out_lock);
+    while(seq - b->next >= BATCH_WINDOW)
+        pthread_cond_wait(&b->turn, &b->out_lock);
+    pthread_mutex_unlock(&b->out_lock);
+
+    pthread_mutex_lock(&b->lock);
+    while(b->len == BATCH_QUEUE)
+        pthread_cond_wait(&b->nonfull, &b->lock);
+    batch_job_t *j = &b->queue[(b->head + b->len) % BATCH_QUEUE];
+    j->r   = r;
+    j->tag = tag;
+    j->seq = seq;
+    b->len++;
+    pthread_cond_signal(&b->nonempty);
+    pthread_mutex_unlock(&b->lock);
+}
+
+/* Returns 0 when the queue is closed and empty. */
+
+static int batch_get(batch_t *b, batch_job_t *j)
+{
+    pthread_mutex_lock(&b->lock);
+    while(b->len == 0 && !b->closed)
+        pthread_cond_wait(&b->nonempty, &b->lock);
+    int got = b->len > 0;
+    if(got) {
+        *j = b->queue[b->head];
+        b->head = (b->head + 1) % BATCH_QUEUE;
+        b->len--;
+        pthread_cond_signal(&b->nonfull);
+    }
+    pthread_mutex_unlock(&b->lock);
+    return got;
+}
+
+/* Writes a finished instance if its turn has come, followed by the held
+ * back instances that are next in turn, and otherwise holds it back. */
+
+static void batch_finish(batch_t *b, batch_done_t *d)
+{
+    pthread_mutex_lock(&b->out_lock);
+    batch_done_t **p = &b->done;
+    while(*p != NULL && (*p)->seq < d->seq)
+        p = &(*p)->next;
+    d->next = *p;
+    *p = d;
+    long next = b->next;
+    while(b->done != NULL && b->done->seq == b->next) {
+        d = b->done;
+        b->done = d->next;
+        outbuf_puts(b->out, "c instance ");
+        outbuf_puts(b->out, d->tag);
+        outbuf_putc(b->out, ' ');
+        outbuf_long(b->out, d->count);
+        outbuf_putc(b->out, '\n');
+        outbuf_write(b->out, d->text, (long) d->size);
+        b->cubes += d->count;
+        free(d->text);
+        FREE(d->tag);
+        FREE(d);
+        b->next++;
+    }
+    if(b->next != next)
+        pthread_cond_broadcast(&b->turn);
+    pthread_mutex_unlock(&b->out_lock);
+}
+
+/* Formats the cubes of an instance, as literals in the CNF mode and as
+ * numbered assignments otherwise. */
+
+static batch_done_t *batch_reduce(outbuf_t *out, batch_job_t *j)
+{
+    reducer_t *r = j->r;
+    reducer_initialize(r);
+    batch_done_t *d = (batch_done_t *) MALLOC(sizeof(batch_done_t));
+    d->tag   = j->tag;
+    d->seq   = j->seq;
+    d->count = 0;
+    d->text  = NULL;
+    d->size  = 0;
+    FILE *m = open_memstream(&d->text, &d->size);
+    if(m == NULL)
+        ERROR("error opening a memory stream");
+    out->out = m;
+    const int *a = NULL;
+    while((a = reducer_get_prefix_assignment(r)) != NULL) {
+        if(r->have_cnf) {
+            outbuf_putc(out, 'a');
+            for(int i = 0; i < a[0]; i++) {
+                outbuf_putc(out, ' ');
+                reducer_put_literal(out, r, reducer_bool_literal(r, a, i));
+            }
+            outbuf_puts(out, " 0\n");
+            d->count++;
+        } else {
+            outbuf_long(out, ++d->count);
+            outbuf_puts(out, ": [");
+            outbuf_long(out, a[2*a[0]+1]);
+            outbuf_puts(out, "] ");
+            reducer_print_assignment(out, r, a);
+        }
+    }
+    outbuf_flush(out);
+    fclose(m);
+    reducer_free(r);
+    return d;
+}
+
+static void *batch_worker(void *arg)
+{
+    batch_t *b = (batch_t *) arg;
+    outbuf_t *out = outbuf_alloc(NULL);
+    batch_job_t j;
+    while(batch_get(b, &j))
+        batch_finish(b, batch_reduce(out, &j));
+    outbuf_free(out);
+    graph_cache_free();
+    return NULL;
+}
+
+/* Skips blank and comment lines, returns 0 at the end of the input. */
+
+static int batch_more(FILE *in)
+{
+    int c;
+    while((c = getc(in)) != EOF) {
+        if(c == 'c') {
+            while((c = getc(in)) != '\n' && c != EOF)
+                ;
+        } else if(c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            ungetc(c, in);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static char *batch_tag(const char *s)
+{
+    char *t = (char *) MALLOC(sizeof(char)*(strlen(s)+1));
+    strcpy(t, s);
+    return t;
+}
+
+static reducer_t *batch_parse(FILE *in, argparse_t *p)
+{
+    reducer_t *r = reducer_parse(in, p);
+    if(arg_have(p, "threshold"))
+        reducer_set_threshold(r, arg_long(p, "threshold"));
+    if(arg_have(p, "select"))
+        reducer_set_select(r, arg_string(p, "select"));
+    if(arg_have(p, "threads"))
+        reducer_set_threads(r, arg_long(p, "threads"));
+    return r;
+}
+
+/* Rejects the options that apply to a single run only. */
+
+static void batch_check_options(argparse_t *p, const char *mode)
+{
+    static const char *single[] = { "passthrough", "symmetry-only", 
+                                    "estimate", "solve", "heartbeat",
+                                    "incremental", "cube-format",
+                                    "family" };
+    for(int i = 0; i < (int) (sizeof(single)/sizeof(single[0])); i++)
+        if(arg_have(p, single[i]))
+            ERROR("option '--%s' does not combine with %s mode", 
+                  single[i], mode);
+}
+
+#define BATCH_NAME_MAX 4096
+
+/* Reduces the instances concatenated in the input, or with '-M' those in
+ * the files listed in the input, one name per line, with a given number 
+ * of worker threads. */
+
+static void reducer_batch(FILE *in, FILE *out, argparse_t *p)
+{
+    batch_check_options(p, "batch");
+    long threads = arg_long(p, "batch");
+    if(threads < 1)
+        ERROR("bad number of batch threads (%ld)", threads);
+
+    batch_t *b = (batch_t *) MALLOC(sizeof(batch_t));
+    b->head   = 0;
+    b->len    = 0;
+    b->closed = 0;
+    b->out    = outbuf_alloc(out);
+    b->cubes  = 0;
+    b->next   = 0;
+    b->done   = NULL;
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->nonempty, NULL);
+    pthread_cond_init(&b->nonfull, NULL);
+    pthread_mutex_init(&b->out_lock, NULL);
+    pthread_cond_init(&b->turn, NULL);
+    pthread_t *workers = (pthread_t *) MALLOC(sizeof(pthread_t)*threads);
+    for(long i = 0; i < threads; i++)
+        if(pthread_create(&workers[i], NULL, batch_worker, b) != 0)
+            ERROR("error creating a batch thread");
+
+    long count = 0;
+    if(arg_have(p, "manifest")) {
+        char name[BATCH_NAME_MAX];
+        while(fgets(name, BATCH_NAME_MAX, in) != NULL) {
+            size_t l = strcspn(name, "\r\n");
+            if(name[l] == 0 && !feof(in))
+                ERROR("manifest line too long");
+            name[l] = 0;
+            if(l == 0)
+                continue;
+            FILE *f = zio_open(name, "r");
+            reducer_t *r = batch_parse(f, p);
+            zio_close(f);
+            batch_put(b, r, batch_tag(name), count);
+            count++;
+        }
+    } else {
+        while(batch_more(in)) {
+            reducer_t *r = batch_parse(in, p);
+            char tag[24];
+            sprintf(tag, "%ld", count + 1);
+            batch_put(b, r, batch_tag(tag), count);
+            count++;
+        }
+    }
+
+    pthread_mutex_lock(&b->lock);
+    b->closed = 1;
+    pthread_cond_broadcast(&b->nonempty);
+    pthread_mutex_unlock(&b->lock);
+    for(long i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+    FREE(workers);
+
+    LOG(LOG_INFO, "batch: instances = %ld, cubes = %ld, threads = %ld\n",
+        count, b->cubes, threads);
+    outbuf_free(b->out);
+    pthread_cond_destroy(&b->turn);
+    pthread_mutex_destroy(&b->out_lock);
+    pthread_cond_destroy(&b->nonfull);
+    pthread_cond_destroy(&b->nonempty);
+    pthread_mutex_destroy(&b->lock);
+    FREE(b);
+}
+
+/************************************************************** Server mode. */
+
+/* 
+ * The server listens on a Unix domain socket and answers requests over
+ * each connection in turn. A request is a line '<command> <length>', or
+ * 'cubes <max> <length>', followed by <length> bytes of instance text in
+ * the format of the input, read with the options of the server. The reply
+ * is a line 'ok <length>' or 'error <length>' followed by <length> bytes.
+ * The commands are
+ *
+ *   symmetry   the order of the group and its generators on the variables
+ *   orbits     the orbits of the variables, one on each line
+ *   cubes      the first <max> cubes (all if <max> is 0)
+ *   shutdown   stop the server (with an empty instance)
+ *
+ * where the group is that of the given prefix, or that of the base graph 
+ * when no prefix is given. Instances are kept parsed and initialized under
+ * a hash of their text, with the least recently used evicted first once 
+ * their estimated footprint exceeds SERVER_MEMORY. A request longer than
+ * SERVER_REQUEST is refused. The parsing, the initialization and the 
+ * search run first or only in a child process, so that no instance can 
+ * end the server with an error.
+ */
+
+#define SERVER_MEMORY   (1L << 30)
+#define SERVER_REQUEST  (1L << 28)
+#define SERVER_ENTRIES  1024
+#define SERVER_HEADER   256
+#define SERVER_MESSAGE  4096
+
+typedef struct server_entry_struct
+{
+    unsigned long hash;
+    long          len;
+    char          *text;     /* The instance, to tell collisions apart. */
+    reducer_t     *r;
+    graph_t       *group;    /* The base graph with the prefix fixed. */
+    long          size;      /* Estimated footprint in bytes. */
+    long          used;      /* Time of last use. */
+} server_entry_t;
+
+typedef struct server_struct
+{
+    argparse_t     *p;
+    server_entry_t entries[SERVER_ENTRIES];
+    int            num_entries;
+    long           size;
+    long           clock;
+    long           hits;
+    long           misses;
+} server_t;
+
+static unsigned long server_hash(long len, const char *s)
+{
+    unsigned long h = 14695981039346656037UL;
+    for(long i = 0; i < len; i++) {
+        h ^= (unsigned char) s[i];
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+/* The text and clauses, and the traversals that dominate the rest. */
+
+static long server_footprint(server_entry_t *e)
+{
+    reducer_t *r = e->r;
+    long s = 2*e->len;
+    for(int i = 0; i < r->k; i++)
+        s += (long) sizeof(int)*r->trav_sizes[i]*r->n;
+    return s;
+}
+
+static void server_evict(server_t *s)
+{
+    int j = 0;
+    for(int i = 1; i < s->num_entries; i++)
+        if(s->entries[i].used < s->entries[j].used)
+            j = i;
+    server_entry_t *e = &s->entries[j];
+    LOG(LOG_DEBUG, "server: evict %016lx\n", e->hash);
+    s->size -= e->size;
+    graph_free(e->group);
+    reducer_free(e->r);
+    FREE(e->text);
+    *e = s->entries[--s->num_entries];
+}
+
+/* The entry in use is the most recent one, and is never evicted. */
+
+static void server_trim(server_t *s)
+{
+    while(s->size > SERVER_MEMORY && s->num_entries > 1)
+        server_evict(s);
+}
+
+/* Runs task(out, arg) in a child process, with the output appended to
+ * m (or dropped if m is NULL), and returns 1 if the child succeeds and
+ * 0 with its error message in msg otherwise. Errors end the child only,
+ * and its logs are dropped. */
+
+static int server_fork(void (*task)(FILE *, void *), void *arg, FILE *m, 
+                       char *msg)
+{
+    int data[2], err[2];
+    if(pipe(data) != 0 || pipe(err) != 0)
+        ERROR("error creating a pipe");
+    log_flush();
+    if(m != NULL)
+        fflush(m);
+    pid_t pid = fork();
+    if(pid < 0)
+        ERROR("error creating a process");
+    if(pid == 0) {
+        close(data[0]);
+        close(err[0]);
+        dup2(err[1], 2);
+        log_set_level(LOG_QUIET);
+        FILE *out = fdopen(data[1], "w");
+        if(out == NULL)
+            ERROR("error opening a pipe");
+        task(out, arg);
+        if(fclose(out) != 0)
+            ERROR("file error writing output");
+        _exit(0);
+    }
+    close(data[1]);
+    close(err[1]);
+    /* The error message is short and fits in the pipe. */
+    char buf[SERVER_MESSAGE];
+    ssize_t c;
+    while((c = read(data[0], buf, SERVER_MESSAGE)) > 0)
+        if(m != NULL)
+            fwrite(buf, 1, c, m);
+    close(data[0]);
+    long l = 0;
+    while((c = read(err[0], msg + l, SERVER_MESSAGE - 1 - l)) > 0)
+        l += c;
+    msg[l] = 0;
+    close(err[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if(!ok && l == 0)
+        strcpy(msg, "instance failed");
+    return ok;
+}
+
+typedef struct server_task_struct
+{
+    argparse_t *p;
+    long       len;
+    const char *text;
+    reducer_t  *r;
+    long       max;
+} server_task_t;
+
+/* Parses and initializes an instance, to check it. */
+
+static void server_task_check(FILE *out, void *arg)
+{
+    server_task_t *t = (server_task_t *) arg;
+    (void) out;
+    FILE *in = fmemopen((void *) t->text, t->len, "r");
+    if(in == NULL)
+        ERROR("error opening the instance");
+    reducer_t *r = batch_parse(in, t->p);
+    fclose(in);
+    reducer_initialize(r);
+}
+
+/* Returns the entry for an instance, or NULL with a message in msg. */
+
+static server_entry_t *server_get(server_t *s, long len, const char *text,
+                             char *msg)
+{
+    unsigned long h = server_hash(len, text);
+    s->clock++;
+    for(int i = 0; i < s->num_entries; i++) {
+        server_entry_t *e = &s->entries[i];
+        if(e->hash == h && e->len == len && !memcmp(e->text, text, len)) {
+            e->used = s->clock;
+            s->hits++;
+            return e;
+        }
+    }
+    s->misses++;
+    if(len == 0) {
+        strcpy(msg, "empty instance");
+        return NULL;
+    }
+    server_task_t t;
+    t.p    = s->p;
+    t.len  = len;
+    t.text = text;
+    if(!server_fork(server_task_check, &t, NULL, msg))
+        return NULL;
+    FILE *in = fmemopen((void *) text, len, "r");
+    reducer_t *r = batch_parse(in, s->p);
+    fclose(in);
+    reducer_initialize(r);
+    /* The searches fork from the entry, so no helper may run on. */
+    spec_cancel(r);
+
+    if(s->num_entries == SERVER_ENTRIES)
+        server_evict(s);
+    server_entry_t *e = &s->entries[s->num_entries++];
+    e->hash  = h;
+    e->len   = len;
+    e->text  = (char *) MALLOC(sizeof(char)*len);
+    memcpy(e->text, text, len);
+    e->r     = r;
+    e->group = graph_dup(r->base);
+    for(int i = 0; i < r->k; i++)
+        graph_add_edge(e->group, r->prefix[i], r->val[0]);
+    e->size  = server_footprint(e);
+    e->used  = s->clock;
+    s->size += e->size;
+    server_trim(s);
+    return e;
+}
+
+static void server_put_vertex(FILE *out, reducer_t *r, int u)
+{
+    int j = r->var_idx[u];
+    if(j >= 0)
+        fputs(r->var_legend[j], out);
+    else
+        fprintf(out, "#%d", u + 1);
+}
+
+static void server_symmetry(FILE *out, server_entry_t *e)
+{
+    reducer_t *r = e->r;
+    graph_t *g = e->group;
+    mpz_t a;
+    mpz_init(a);
+    group_order(a, g);
+    fputs("|Aut| = ", out);
+    mpz_out_str(out, 10, a);
+    fputs("\n", out);
+    mpz_clear(a);
+
+    /* The generators as cycles on the variables. */
+    int *seen = (int *) MALLOC(sizeof(int)*r->n);
+    const int *q = NULL;
+    while((q = graph_aut_gen(g)) != NULL) {
+        for(int u = 0; u < r->n; u++)
+            seen[u] = 0;
+        int moved = 0;
+        for(int i = 0; i < r->v; i++) {
+            int z = r->var[i];
+            if(seen[z] || q[z] == z)
+                continue;
+            fputc('(', out);
+            int w = z;
+            do {
+                seen[w] = 1;
+                server_put_vertex(out, r, w);
+                w = q[w];
+                fputc(w == z ? ')' : ' ', out);
+            } while(w != z);
+            moved = 1;
+        }
+        if(moved)
+            fputc('\n', out);
+    }
+    FREE(seen);
+}
+
+static void server_orbits(FILE *out, server_entry_t *e)
+{
+    reducer_t *r = e->r;
+    graph_t *g = e->group;
+    const int *cells = graph_orbit_cells(g);
+    const int *start = graph_orbit_starts(g);
+    int nc = graph_orbit_ncells(g);
+    for(int o = 0; o < nc; o++) {
+        int first = 1;
+        for(int i = start[o]; i < start[o+1]; i++) {
+            if(r->var_idx[cells[i]] < 0)
+                continue;
+            if(!first)
+                fputc(' ', out);
+            server_put_vertex(out, r, cells[i]);
             first = 0;
-            if(l == 0) {
-                FPRINTF(out, "\n");
-                first = 1;
-                break;
+        }
+        if(!first)
+            fputc('\n', out);
+    }
+}
+
+static void server_cubes(FILE *out, reducer_t *r, long max)
+{
+    outbuf_t *ob = outbuf_alloc(out);
+    r->stack_top = 0; /* Restart the search. */
+    long count = 0;
+    const int *a = NULL;
+    while((max == 0 || count < max) &&
+          (a = reducer_get_prefix_assignment(r)) != NULL) {
+        count++;
+        int d = a[0];
+        if(r->have_cnf) {
+            outbuf_putc(ob, 'a');
+            for(int i = 0; i < d; i++) {
+                outbuf_putc(ob, ' ');
+                reducer_put_literal(ob, r, reducer_bool_literal(r, a, i));
             }
+            outbuf_puts(ob, " 0\n");
+        } else {
+            outbuf_long(ob, count);
+            outbuf_puts(ob, ": [");
+            outbuf_long(ob, a[2*d+1]);
+            outbuf_puts(ob, "] ");
+            reducer_print_assignment(ob, r, a);
         }
     }
+    outbuf_free(ob);
 }
 
-/********************************* Get a prefix assignment from the reducer. */
+static void server_task_cubes(FILE *out, void *arg)
+{
+    server_task_t *t = (server_task_t *) arg;
+    server_cubes(out, t->r, t->max);
+}
 
-static int aut_order_trunc(graph_t *g)
+static int server_reply(FILE *out, const char *status, long len, 
+                        const char *s)
 {
-    mpz_t aut_order;
-    mpz_init(aut_order);
-    mpz_set_si(aut_order, 1L);
-    const int *ai = graph_aut_idx(g);
-    while(*ai != 0) {
-        mpz_mul_si(aut_order, aut_order, (long) *ai);
-        ai++;
+    return fprintf(out, "%s %ld\n", status, len) >= 0 &&
+           fwrite(s, 1, len, out) == (size_t) len &&
+           fflush(out) == 0;
+}
+
+/* Serves the requests on one connection, returns 0 on 'shutdown'. */
+
+static int server_connection(server_t *s, int fd)
+{
+    FILE *in  = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    if(in == NULL || out == NULL)
+        ERROR("error opening a connection");
+    int running = 1;
+    char header[SERVER_HEADER];
+    char msg[SERVER_MESSAGE];
+    while(running && fgets(header, SERVER_HEADER, in) != NULL) {
+        char cmd[SERVER_HEADER];
+        long x, y;
+        long max = 0;
+        long len = -1;
+        int cubes = 0;
+        int c = sscanf(header, "%255s %ld %ld", cmd, &x, &y);
+        if(c >= 2) {
+            cubes = !strcmp(cmd, "cubes");
+            if(c == 3 && cubes) {
+                max = x;
+                len = y;
+            } else if(c == 2 && !cubes) {
+                len = x;
+            }
+        }
+        if(len < 0 || max < 0) {
+            strcpy(msg, "bad request header");
+            server_reply(out, "error", strlen(msg), msg);
+            break;
+        }
+        if(len > SERVER_REQUEST) {
+            strcpy(msg, "request too large");
+            server_reply(out, "error", strlen(msg), msg);
+            break;
+        }
+        char *text = (char *) MALLOC(sizeof(char)*(len+1));
+        if(fread(text, 1, len, in) != (size_t) len) {
+            FREE(text);
+            break;
+        }
+        char *buf = NULL;
+        size_t size = 0;
+        FILE *m = open_memstream(&buf, &size);
+        int ok = 1;
+        if(!strcmp(cmd, "shutdown")) {
+            running = 0;
+        } else if(cubes || !strcmp(cmd, "symmetry") || 
+                  !strcmp(cmd, "orbits")) {
+            server_entry_t *e = server_get(s, len, text, msg);
+            if(e == NULL) {
+                ok = 0;
+            } else if(cubes) {
+                /* The search runs in a child on a copy of the entry, 
+                 * which stays as initialized. */
+                server_task_t t;
+                t.r   = e->r;
+                t.max = max;
+                ok = server_fork(server_task_cubes, &t, m, msg);
+            } else if(!strcmp(cmd, "symmetry")) {
+                server_symmetry(m, e);
+            } else {
+                server_orbits(m, e);
+            }
+        } else {
+            sprintf(msg, "unknown command '%.64s'", cmd);
+            ok = 0;
+        }
+        fclose(m);
+        int sent = ok ? server_reply(out, "ok", size, buf) : 
+                        server_reply(out, "error", strlen(msg), msg);
+        free(buf);
+        FREE(text);
+        log_flush();
+        if(!sent)
+            break;
     }
-    int aut_trunc = 999999999;
-    if(mpz_cmp_si(aut_order, aut_trunc) < 0)
-        aut_trunc = (int) mpz_get_si(aut_order);
-    mpz_clear(aut_order);
-    return aut_trunc;
+    fclose(out);
+    fclose(in);
+    return running;
 }
 
-const int *reducer_get_prefix_assignment(reducer_t *r)
+/* Listens on the socket at path until a 'shutdown' request. The socket
+ * is accessible to the owner only. */
+
+static void reducer_serve(const char *path, argparse_t *p)
 {
-    int n = r->n;
-    int k = r->k;
-    int d = r->r;
+    batch_check_options(p, "server");
+    if(arg_have(p, "batch"))
+        ERROR("option '--batch' does not combine with server mode");
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path))
+        ERROR("socket path too long");
+    strcpy(addr.sun_path, path);
+    struct stat st;
+    if(lstat(path, &st) == 0) {
+        if(!S_ISSOCK(st.st_mode))
+            ERROR("'%s' exists and is not a socket", path);
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        ERROR("error creating a socket");
+    mode_t mask = umask(077);
+    if(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+        ERROR("error binding the socket to '%s'", path);
+    umask(mask);
+    if(listen(fd, 16) != 0)
+        ERROR("error listening on '%s'", path);
+    signal(SIGPIPE, SIG_IGN);
+    LOG(LOG_INFO, "server: listening on %s\n", path);
+    log_flush();
+
+    server_t *s = (server_t *) MALLOC(sizeof(server_t));
+    s->p           = p;
+    s->num_entries = 0;
+    s->size        = 0;
+    s->clock       = 0;
+    s->hits        = 0;
+    s->misses      = 0;
+    int running = 1;
+    while(running) {
+        int c = accept(fd, NULL, NULL);
+        if(c < 0)
+            continue;
+        running = server_connection(s, c);
+    }
+    close(fd);
+    unlink(path);
 
-    if(r->target_length == 0)
-        return NULL;
-        
-    if(r->stack_top == 0) {
-        if(k == 0) {
-            /* Initialize the prefix. */            
-            int p = orbit_select(r->base, r->v, r->var,
-                                 k, r->prefix,
-                                 k > 0 ?
-                                 r->trav_ind[k-1] : 
-                                 NULL);
-            r->last_prefix_g = reducer_expand_prefix(r, k, p, NULL);
-            k++;
-        }
+    LOG(LOG_INFO, "server: hits = %ld, misses = %ld, cached = %d\n",
+        s->hits, s->misses, s->num_entries);
+    while(s->num_entries > 0)
+        server_evict(s);
+    FREE(s);
+    graph_cache_free();
+}
 
-        /* Initialize minimum indicators for orbits of the base graph. */
-        orbit_min_ind(r->base, NULL, r->seed_min[0]);
+/*********************************************** Built-in instance families. */
 
-        /* Initialize the iterator work stack. */
-        /* Caveat: should initialize the r->a assigned variables here. */
-        /* First variable is minimum in its base-automorphism orbit. */
+/* 
+ * The families are built in memory, without going through the input:
+ *
+ *   graph:<n>            the edges of a graph on n points (cf. 
+ *                        'A000088-test.pl'), without CNF
+ *   hypergraph:<n>:<k>   the edges of a k-uniform hypergraph on n points,
+ *                        without CNF
+ *   php:<p>:<h>          p pigeons in h holes, variable i*h+j+1 placing 
+ *                        the pigeon i in the hole j
+ *   ramsey:<s>:<t>:<n>   graphs on n points with no clique of order s and
+ *                        no independent set of order t, with the edges
+ *                        as variables in lexicographic order
+ *
+ * Each variable vertex is joined to the vertices of its points (or of its
+ * pigeon and hole), so that the symmetries are those of the points. Unless
+ * given with '-p' or '-l', the prefix consists of all the variables.
+ */
 
-        int p = 0;
-        for(; p < r->trav_sizes[0]; p++) {
-            if(r->seed_min[0][r->traversals[0][p][r->prefix[0]]]) {
-                r->work[0] = r->traversals[0][p][r->prefix[0]];
-                break;
-            }
-        }
-        if(p == r->trav_sizes[0])
-            ABORT("no minimum found for base orbit");
-        r->work[1] = 0;
-        r->work[2] = 1;
-        r->stack_top = 3;
+#define FAMILY_MAX_PARAMS 3
 
-        for(int i = 0; i < k; i++) {
-            r->stat_out[i] = 0;
-            r->stat_gen[i] = 0;
-            r->stat_can[i] = 0;
-        }
+static long binomial(int n, int k)
+{
+    long b = 1;
+    for(int i = 1; i <= k; i++) {
+        b = b*(n - k + i)/i;
+        if(b > INT_MAX)
+            ERROR("instance too large");
     }
-    while(r->stack_top > 0) {
-        /* Pop the stack top. */
-        int size = r->work[r->stack_top - 1];
-        int *vars = r->work + r->stack_top - 1 - 2*size;
-        int *vals = r->work + r->stack_top - 1 - size;
-        r->stack_top = r->stack_top - (2*size+1);
+    return b;
+}
 
-        /* Find the current variable. */
-        int lvl = size - 1;
-        int current = -1;
-        int current_idx = -1;
-        for(int j = 0; j < r->trav_sizes[lvl]; j++) {
-            for(int i = 0; i < size; i++) {             
-                if(vars[i] == r->traversals[lvl][j][r->prefix[lvl]]) {
-                    current = j;
-                    current_idx = i;
-                }
-            }
-        }
-        if(current == -1)
-            ABORT("no current variable");
+/* Steps s[0] < s[1] < ... < s[k-1] to the next k-subset of {0,1,...,n-1}
+ * in lexicographic order, returns 0 after the last one. */
 
-        if(size >= r->prefix_capacity)
-            ABORT("prefix overrun");
+static int subset_next(int n, int k, int *s)
+{
+    int i = k - 1;
+    while(i >= 0 && s[i] == n - k + i)
+        i--;
+    if(i < 0)
+        return 0;
+    s[i]++;
+    for(int j = i + 1; j < k; j++)
+        s[j] = s[j-1] + 1;
+    return 1;
+}
 
-        int current_val = vals[current_idx];
-        if(current_val < d) {
-            r->stat_gen[lvl]++;
+/* The index of the edge {i,j}, i < j, among the edges on n points. */
 
-            /* Save next value, relying on existing stack contents. */
-            vals[current_idx]++;
-            r->stack_top = r->stack_top + (2*size+1);
-            
-            /* Process stack top. */
-            int *nu = (int *) MALLOC(sizeof(int)*n);
-            for(int i = 0; i < n; i++)
-                nu[r->traversals[lvl][current][i]] = i;
-            if(nu[vars[current_idx]] != r->prefix[lvl])
-                ABORT("bad nu");
-            graph_t *g = graph_dup(r->base);
-            for(int i = 0; i < size; i++) {
-                if(i != current_idx) {
-                    graph_add_edge(g, vars[i], r->val[vals[i]]);
-                } else {
-                    graph_add_edge(g, vars[i], r->val[current_val]);
-                }
-            }
-            const int *lab = graph_can_lab(g);
-            int qlab = -1;
-            int t = 0;          
-            for(; t < n; t++) {
-                qlab = lab[t];
-                if(r->orbits[lvl][nu[qlab]])
-                    break;
-            }
-            if(t == n)
-                ABORT("bad qlab");
-            if(graph_same_orbit(g, qlab, vars[current_idx])) {
-                /* Top was accepted by isomorph rejection. */
-                r->stat_can[lvl]++;
-                
-                /* Normalize top to scratch. */
-                r->scratch[0] = size;
-                int *norm_vars = r->scratch + 1;
-                int *norm_vals = r->scratch + 1 + size;
-                for(int i = 0; i < size; i++) {
-                    norm_vars[i] = nu[vars[i]];
-                    if(i != current_idx) {
-                        norm_vals[i] = vals[i];
-                    } else {
-                        norm_vals[i] = current_val;
-                    }
-                }
-                int aut = aut_order_trunc(g);
-                r->scratch[2*size+1] = aut;
-                if(size == r->target_length || aut <= r->t) {
-                    for(int i = 0; i < size; i++)
-                        norm_vals[i] = r->val[norm_vals[i]];
-                    FREE(nu);
-                    graph_free(g);
-                    /* Report to caller. */
-                    r->stat_out[lvl]++;
-                    return r->scratch;
-                } else {
-                    /* Expand. */
-                    if(size + 1 > k) {
-                        /* Expand prefix. */
-                        graph_t *lpg = r->last_prefix_g;
-                        int p = orbit_select(lpg, r->v, r->var,
-                                             k, r->prefix,
-                                             k > 0 ?
-                                             r->trav_ind[k-1] : 
-                                             NULL);
-                        lpg = reducer_expand_prefix(r, k, p, lpg);
-                        r->last_prefix_g = lpg;
-                        k++;
-                        /* Reset pointers to potentially new scratch. */
-                        norm_vars = r->scratch + 1;
-                        norm_vals = r->scratch + 1 + size;
-                    }
-                    int *exp_vars = r->work + r->stack_top;
-                    int *exp_vals = r->work + r->stack_top + (size + 1);
-                    r->work[r->stack_top + 2*(size+1)] = size + 1;
-                    r->stack_top = r->stack_top + 2*(size+1) + 1;
-                    
-                    for(int i = 0; i < size; i++) {
-                        exp_vars[i] = norm_vars[i];
-                        exp_vals[i] = norm_vals[i];
-                    }
+static int pair_index(int n, int i, int j)
+{
+    return i*n - i*(i+1)/2 + j - i - 1;
+}
 
-                    /* Save minima of (normalised) automorphism orbits. */
-                    orbit_min_ind(g, nu, r->seed_min[lvl+1]);
+/* Sets up a graph of n vertices with the variables 0,1,...,v-1 and the 
+ * values 'false' and 'true' at v and v+1; returns the colors, which the 
+ * caller completes for the vertices from v+2 on. */
 
-                    /* First var is minimum in its seed-automorphism orbit. */
-                    int s = 0;
-                    for(; s < r->trav_sizes[lvl+1]; s++) {
-                        if(r->seed_min[lvl+1][r->traversals[lvl+1][s][r->prefix[lvl+1]]]) {                         
-                            exp_vars[size] = 
-                                r->traversals[lvl+1][s][r->prefix[lvl+1]];
-                            break;
-                        }
-                    }
-                    if(s == r->trav_sizes[lvl+1])
-                        ABORT("no minimum found in extending orbit");
-                    exp_vals[size] = 0;
-                }
-            }
-            FREE(nu);
-            graph_free(g);
-        } else {
-            /* Proceed to the next variable, if any. */
-            /* Next variable must be minimum in its seed-automorphism orbit. */
-            /* Again rely on existing stack contents. */          
-            for(; current + 1 < r->trav_sizes[lvl]; current++) {
-                if(r->seed_min[lvl][r->traversals[lvl][current+1][r->prefix[lvl]]]) {
-                    vars[current_idx] = 
-                        r->traversals[lvl][current+1][r->prefix[lvl]];
-                    vals[current_idx] = 0;
-                    r->stack_top = r->stack_top + 2*size + 1;
-                    break;
-                }               
-            }
+static int *family_start(reducer_t *r, int n, int v)
+{
+    r->n = n;
+    r->base = graph_alloc(n);
+    r->v = v;
+    r->var = (int *) MALLOC(sizeof(int)*v);
+    r->var_legend = (char **) MALLOC(sizeof(char *)*v);
+    for(int i = 0; i < v; i++)
+        r->var[i] = i;
+    r->r = 2;
+    r->val = (int *) MALLOC(sizeof(int)*2);
+    r->val_legend = (char **) MALLOC(sizeof(char *)*2);
+    r->val[0] = v;
+    r->val[1] = v + 1;
+    r->val_legend[0] = legend_string("false");
+    r->val_legend[1] = legend_string("true");
+    int *colors = (int *) MALLOC(sizeof(int)*n);
+    for(int u = 0; u < n; u++)
+        colors[u] = u < v ? 0 : u - v + 1;
+    return colors;
+}
+
+static void family_finish(reducer_t *r, int *colors)
+{
+    color_graph(r->base, colors);
+    FREE(colors);
+}
+
+/* The k-subsets of n points as variables, named by their points, or with
+ * 'cnf' by their CNF variables. */
+
+static void family_subsets(reducer_t *r, int n, int k, int cnf)
+{
+    int v = (int) binomial(n, k);
+    if(v + 2L + n > INT_MAX)
+        ERROR("instance too large");
+    int *colors = family_start(r, v + 2 + n, v);
+    for(int u = v + 2; u < v + 2 + n; u++)
+        colors[u] = 3;
+    int *s = (int *) MALLOC(sizeof(int)*k);
+    char *t = (char *) MALLOC(sizeof(char)*(12*k+1));
+    for(int j = 0; j < k; j++)
+        s[j] = j;
+    int i = 0;
+    do {
+        int l = 0;
+        for(int j = 0; j < k; j++) {
+            graph_add_edge(r->base, i, v + 2 + s[j]);
+            l += sprintf(t + l, j == 0 ? "%d" : "-%d", s[j] + 1);
         }
-    }
-    if(r->stack_top < 0)
-        ABORT("work stack out of balance");
-    /* Work done. */
+        r->var_legend[i] = cnf ? legend_number(i + 1) : legend_string(t);
+        i++;
+    } while(subset_next(n, k, s));
+    FREE(t);
+    FREE(s);
+    family_finish(r, colors);
+}
 
-    return NULL;
+static void family_graph(reducer_t *r, const int *q)
+{
+    if(q[0] < 2)
+        ERROR("bad number of points (%d)", q[0]);
+    family_subsets(r, q[0], 2, 0);
 }
 
-/********************** Print a prefix assignment obtained from the reducer. */
+static void family_hypergraph(reducer_t *r, const int *q)
+{
+    if(q[1] < 1 || q[1] > q[0])
+        ERROR("bad number of points (%d) or edge size (%d)", q[0], q[1]);
+    family_subsets(r, q[0], q[1], 0);
+}
 
-void reducer_print_assignment(FILE *out, reducer_t *r, const int *a)
+static void family_php(reducer_t *r, const int *q)
 {
-    int size = a[0];
-    const int *vars = a + 1;
-    const int *vals = a + 1 + size;
-    for(int i = 0; i < size; i++) {
-        int j, jj;
-        for(j = 0; j < r->v; j++) {
-            if(vars[i] == r->var[j])
-                break;          
+    int p = q[0];
+    int h = q[1];
+    if(p < 1 || h < 1 || (long) p*h + 2 + p + h > INT_MAX)
+        ERROR("bad numbers of pigeons (%d) and holes (%d)", p, h);
+    int v = p*h;
+    int *colors = family_start(r, v + 2 + p + h, v);
+    for(int i = 0; i < p; i++)
+        colors[v + 2 + i] = 3;
+    for(int j = 0; j < h; j++)
+        colors[v + 2 + p + j] = 4;
+    for(int i = 0; i < p; i++) {
+        for(int j = 0; j < h; j++) {
+            graph_add_edge(r->base, i*h + j, v + 2 + i);
+            graph_add_edge(r->base, i*h + j, v + 2 + p + j);
+            r->var_legend[i*h + j] = legend_number(i*h + j + 1);
         }
-        for(jj = 0; jj < r->r; jj++) {
-            if(vals[i] == r->val[jj])
-                break;          
+    }
+    family_finish(r, colors);
+
+    /* Each pigeon in some hole, no two pigeons in the same hole. */
+    long pairs = binomial(p, 2);
+    long nc = p + h*pairs;
+    long len = p*(h + 1L) + 3*h*pairs;
+    int *buf = (int *) MALLOC(sizeof(int)*len);
+    long l = 0;
+    for(int i = 0; i < p; i++) {
+        for(int j = 0; j < h; j++)
+            buf[l++] = i*h + j + 1;
+        buf[l++] = 0;
+    }
+    for(int j = 0; j < h; j++) {
+        for(int i = 0; i < p; i++) {
+            for(int ii = i + 1; ii < p; ii++) {
+                buf[l++] = -(i*h + j + 1);
+                buf[l++] = -(ii*h + j + 1);
+                buf[l++] = 0;
+            }
         }
-        if(j == r->v || jj == r->r)
-            ABORT("no data for assignment");
-        FPRINTF(out, "%s -> %s%s", 
-                r->var_legend[j], 
-                r->val_legend[jj],
-                i == size-1 ? "\n" : ", ");
     }
+    reducer_set_clauses(r, v, nc, buf, len);
+}
+
+/* A clause for each s-subset and t-subset of the points, with the edges
+ * among them as negative and positive literals, respectively. */
+
+static void ramsey_clauses(int n, int s, int sign, int *buf, long *l)
+{
+    int *a = (int *) MALLOC(sizeof(int)*s);
+    for(int j = 0; j < s; j++)
+        a[j] = j;
+    do {
+        for(int i = 0; i < s; i++)
+            for(int j = i + 1; j < s; j++)
+                buf[(*l)++] = sign*(pair_index(n, a[i], a[j]) + 1);
+        buf[(*l)++] = 0;
+    } while(subset_next(n, s, a));
+    FREE(a);
+}
+
+static void family_ramsey(reducer_t *r, const int *q)
+{
+    int s = q[0];
+    int t = q[1];
+    int n = q[2];
+    if(s < 2 || t < 2 || s > n || t > n)
+        ERROR("bad parameters s = %d, t = %d, n = %d", s, t, n);
+    family_subsets(r, n, 2, 1);
+    long ns = binomial(n, s);
+    long nt = binomial(n, t);
+    long nc = ns + nt;
+    long len = ns*(binomial(s, 2) + 1) + nt*(binomial(t, 2) + 1);
+    int *buf = (int *) MALLOC(sizeof(int)*len);
+    long l = 0;
+    ramsey_clauses(n, s, -1, buf, &l);
+    ramsey_clauses(n, t, 1, buf, &l);
+    reducer_set_clauses(r, r->v, nc, buf, len);
+}
+
+typedef struct family_struct
+{
+    const char *name;
+    int         num_params;
+    void        (*build)(reducer_t *r, const int *q);
+} family_t;
+
+static const family_t families[] = {
+    { "graph",      1, family_graph },
+    { "hypergraph", 2, family_hypergraph },
+    { "php",        2, family_php },
+    { "ramsey",     3, family_ramsey }
+};
+
+#define NUM_FAMILIES ((int) (sizeof(families)/sizeof(families[0])))
+
+/* Builds the instance given as '<name>:<param>:...' with '-F'. */
+
+static reducer_t *reducer_family(argparse_t *p)
+{
+    if(arg_have(p, "passthrough"))
+        ERROR("passthrough needs the instance in the input");
+    static const char *input[] = { "file", "graph", "no-cnf", 
+                                   "basic-graph" };
+    for(int i = 0; i < (int) (sizeof(input)/sizeof(input[0])); i++)
+        if(arg_have(p, input[i]))
+            ERROR("option '--%s' does not combine with '--family'", 
+                  input[i]);
+    const char *s = arg_string(p, "family");
+    int l = (int) strcspn(s, ":");
+    const family_t *f = NULL;
+    for(int i = 0; i < NUM_FAMILIES; i++)
+        if((int) strlen(families[i].name) == l && 
+           !strncmp(s, families[i].name, l))
+            f = &families[i];
+    if(f == NULL)
+        ERROR("unknown family '%.*s'", l, s);
+    int q[FAMILY_MAX_PARAMS];
+    int c = 0;
+    s += l;
+    while(*s == ':' && c < FAMILY_MAX_PARAMS) {
+        char *e;
+        long x = strtol(s + 1, &e, 10);
+        if(e == s + 1 || x < 0 || x > INT_MAX)
+            break;
+        q[c++] = (int) x;
+        s = e;
+    }
+    if(*s != 0 || c != f->num_params)
+        ERROR("family '%s' expects %d parameters", f->name, f->num_params);
+
+    reducer_t *r = reducer_alloc();
+    f->build(r, q);
+    if(!arg_have(p, "prefix") && !arg_have(p, "length")) {
+        reducer_alloc_prefix(r, r->v);
+        r->k = r->v;
+        for(int i = 0; i < r->v; i++)
+            r->prefix[i] = r->var[i];
+    }
+    reducer_configure(r, p);
+    return r;
 }
 
 /****************************************************** Program entry point. */
@@ -1656,22 +4493,56 @@ const char *usage_str =
 "short   long                function\n"    
 "   -h   --help              print this help text to stdout and exit\n"
 "   -u   --usage             print this help text to stdout and exit\n"
-"   -f   --file <IN>         read input from file <IN>\n"
-"   -o   --output <OUT>      write output to file <OUT>\n"
+"   -f   --file <IN>         read input from file <IN> (may be compressed)\n"
+"   -o   --output <OUT>      write output to file <OUT> (compressed if\n"
+"                            it ends in .gz, .xz, or .zst)\n"
 "   -n   --no-cnf            do not expect CNF in input\n"
 "   -g   --graph             separate symmetry graph supplied in input\n"
+"   -b   --basic-graph       use one vertex per clause in the symmetry graph\n"
+"   -P   --passthrough       copy the clauses from the (seekable) input\n"
 "   -p   --prefix <SEQ>      use the prefix <SEQ> of variable vertices\n"
 "   -l   --length <K>        set target length for prefix to <K>\n"
+"   -S   --select <NAME>     select prefix points with strategy <NAME>\n"
+"                            (default, smallest, occurrence, stabilizer,\n"
+"                            or lookahead)\n"
+"   -j   --threads <N>       compute the levels of a given prefix with\n"
+"                            <N> threads, or the next level ahead with\n"
+"                            a helper thread\n"
 "   -t   --threshold <N>     output partial assignment when |Aut| <= <N>\n"
 "   -s   --symmetry-only     print symmetry information only\n"
+"   -e   --estimate <N>      estimate the search with <N> random probes\n"
+"   -H   --heartbeat <S>     report progress every <S> seconds\n"
+"   -W   --status <FILE>     write progress reports to <FILE>\n"
 "   -i   --incremental       give output in icnf format\n"
-"   -v   --verbose           verbose output\n"
+"   -c   --cube-format <F>   give cubes in format <F> (text or binary)\n"
+"   -A   --solve             solve the CNF under each cube in turn with\n"
+"                            the linked IPASIR solver\n"
+"   -B   --batch <N>         reduce a stream of instances with <N> threads\n"
+"   -M   --manifest          batch input lists instance files, one a line\n"
+"   -D   --serve <SOCKET>    answer queries on the Unix socket <SOCKET>\n"
+"   -F   --family <F>        build the instance <F> instead of reading it\n"
+"                            (graph:N, hypergraph:N:K, php:P:H, or\n"
+"                            ramsey:S:T:N)\n"
+"   -d   --decompose         label components of the symmetry graph apart\n"
+"   -w   --twins             collapse twin vertices of the symmetry graph\n"
+"   -v   --verbose           verbose output (same as '-L debug')\n"
+"   -q   --quiet             no diagnostics (same as '-L quiet')\n"
+"   -L   --log <LEVEL>       diagnostics at <LEVEL> (quiet, info, debug,\n"
+"                            or trace for a line per cube)\n"
 "\n";
 
 int main(int argc, char **argv)
 {
+    log_buffer();
     argparse_t *p = arg_parse(argc, argv);
-    arg_print(stderr, p);
+    if(arg_have(p, "verbose"))
+        log_set_level(LOG_DEBUG);
+    if(arg_have(p, "quiet"))
+        log_set_level(LOG_QUIET);
+    if(arg_have(p, "log"))
+        log_set_level(log_parse_level(arg_string(p, "log")));
+    if(LOGGING(LOG_DEBUG))
+        arg_print(stderr, p);
 
     if(arg_have(p, "help") || arg_have(p, "usage")) {
         FPRINTF(stdout, usage_str, argv[0]);
@@ -1680,45 +4551,100 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    FILE *in = stdin;
-    if(arg_have(p, "file")) {
-        if((in = fopen(arg_string(p, "file"), "r")) == NULL)
-            ERROR("error opening \"%s\" for input", arg_string(p, "file"));
+    if(arg_have(p, "serve")) {
+        reducer_serve(arg_string(p, "serve"), p);
+        log_flush();
+        arg_free(p);
+        common_check_balance();
+        return 0;
     }
 
-    FILE *out = stdout;
-    if(arg_have(p, "output")) {
-        if((out = fopen(arg_string(p, "output"), "w")) == NULL)
-            ERROR("error opening \"%s\" for output", arg_string(p, "output"));
+    /* Compressed input and output are handled by zio_open(). */
+    FILE *in  = arg_have(p, "family") ? NULL :
+                zio_open(arg_have(p, "file") ? 
+                         arg_string(p, "file") : NULL, "r");
+    FILE *out = zio_open(arg_have(p, "output") ?
+                         arg_string(p, "output") : NULL, "w");
+
+    if(arg_have(p, "batch")) {
+        reducer_batch(in, out, p);
+        zio_close(out);
+        zio_close(in);
+        log_flush();
+        arg_free(p);
+        common_check_balance();
+        return 0;
     }
 
     enable_timing(); // enable timings
 
     push_time();
     push_time();
-    reducer_t *r = reducer_parse(in, p);
+    reducer_t *r = in == NULL ? reducer_family(p) : reducer_parse(in, p);
     if(arg_have(p, "threshold"))
-        r->t = arg_long(p, "threshold");
-    fprintf(stderr, 
-            "input: n = %d, m = %ld, v = %d, r = %d, k = %d, t = %ld",
-            r->n, graph_num_edges(r->base), r->v, r->r, r->k, r->t);
+        reducer_set_threshold(r, arg_long(p, "threshold"));
+    if(arg_have(p, "select"))
+        reducer_set_select(r, arg_string(p, "select"));
+    if(arg_have(p, "threads"))
+        reducer_set_threads(r, arg_long(p, "threads"));
+    if(arg_have(p, "heartbeat"))
+        reducer_set_heartbeat(r, arg_long(p, "heartbeat"),
+                              arg_have(p, "status") ? 
+                              arg_string(p, "status") : NULL);
+    LOG(LOG_INFO,
+        "input: n = %d, m = %ld, v = %d, r = %d, k = %d, t = %ld",
+        r->n, graph_num_edges(r->base), r->v, r->r, r->k, r->t);
     pop_print_time("reducer_parse");
-    fprintf(stderr, "\n");
+    LOG(LOG_INFO, "\n");
+    log_flush();
 
     reducer_initialize(r);
 
     disable_timing(); // time only the init phase
 
-    if(!arg_have(p, "symmetry-only")) {
-        if(!arg_have(p, "incremental")) {
+    if(arg_have(p, "estimate") && !arg_have(p, "symmetry-only")) {
+        reducer_estimate(r, arg_long(p, "estimate"));
+    } else if(arg_have(p, "solve") && !arg_have(p, "symmetry-only")) {
+        if(!r->have_cnf)
+            ERROR("solving requires CNF input");
+#ifdef HAVE_IPASIR
+        outbuf_t *ob = outbuf_alloc(out);
+        reducer_solve(ob, r);
+        outbuf_free(ob);
+#else
+        ERROR("solving needs a build with an IPASIR solver (cf. 'Makefile')");
+#endif
+    } else if(!arg_have(p, "symmetry-only")) {
+        int binary = 0;
+        if(arg_have(p, "cube-format")) {
+            const char *f = arg_string(p, "cube-format");
+            if(!strcmp(f, "binary"))
+                binary = 1;
+            else if(strcmp(f, "text"))
+                ERROR("unknown cube format '%s'", f);
+            if(binary && !r->have_cnf)
+                ERROR("binary cube format requires CNF input");
+            if(binary && arg_have(p, "incremental"))
+                ERROR("option '--incremental' does not combine with "
+                      "binary cube format");
+        }
+        outbuf_t *ob = outbuf_alloc(out);
+        if(binary) {
+            /* Only the cubes, in a binary stream; cf. 'cube.h'. */
+            cube_write_header(ob, r->nv);
+            cube_writer_t *w = cube_writer_start(r, ob, CUBES_BINARY);
+            const int *a = NULL;
+            while((a = reducer_get_prefix_assignment(r)) != NULL)
+                cube_writer_put(w, a);
+            cube_writer_finish(w);
+            cube_write_end(ob);
+        } else if(!arg_have(p, "incremental")) {
             if(!r->have_cnf) {
-                int count = 0;
+                cube_writer_t *w = cube_writer_start(r, ob, CUBES_TEXT);
                 const int *a = NULL;
-                while((a = reducer_get_prefix_assignment(r)) != NULL) {
-                    count++;
-                    FPRINTF(out, "%d: [%d] ", count, a[2*a[0]+1]);
-                    reducer_print_assignment(out, r, a);
-                }
+                while((a = reducer_get_prefix_assignment(r)) != NULL)
+                    cube_writer_put(w, a);
+                cube_writer_finish(w);
             } else {
                 /* Store conjuncts in a buffer. */
                 int conjbuf_cap = 128;
@@ -1734,15 +4660,13 @@ int main(int argc, char **argv)
                         enlarge_int_array(&conjbuf, conjbuf_cap, new_cap);
                         conjbuf_cap = new_cap;
                     }
-                    fprintf(stderr, "c branch %d %d\n", count, a[2*len+1]);
+                    LOG(LOG_TRACE, "c branch %d %d\n", count, a[2*len+1]);
                     for(int i = 0; i < len; i++)
-                        conjbuf[cursor++] = (a[1+i+len] == r->val[0]) ?
-                            -(1+r->var_trans[a[1+i]]) :
-                            1+r->var_trans[a[1+i]];
+                        conjbuf[cursor++] = reducer_bool_literal(r, a, i);
                     conjbuf[cursor++] = 0;
                 }
                 /* Print CNF with adjust for conjunct-clauses. */
-                reducer_print_cnf(out, 
+                reducer_print_cnf(ob, 
                                   "cnf", 
                                   count, 
                                   cursor - count + 1, 
@@ -1753,72 +4677,71 @@ int main(int argc, char **argv)
                 int end = cursor;
                 cursor = 0;
                 while(cursor < end) {
-                    if(conjbuf[cursor] == 0)
+                    if(conjbuf[cursor] == 0) {
                         u++;
-                    else
-                        FPRINTF(out, 
-                                "%d %d 0\n", 
-                                conjbuf[cursor],
-                                -(1 + nv_base + u));
+                    } else {
+                        outbuf_long(ob, conjbuf[cursor]);
+                        outbuf_putc(ob, ' ');
+                        outbuf_long(ob, -(1 + nv_base + u));
+                        outbuf_puts(ob, " 0\n");
+                    }
                     cursor++;
                 }
                 if(u != count)
                     ABORT("bad conjunct buffer");
                 /* Print the final clause of conjunct-variables. */
-                for(int i = 0; i < count; i++)
-                    FPRINTF(out, 
-                            "%d%s",
-                            1 + nv_base + i,
-                            i == count - 1 ? " 0\n" : " ");
+                for(int i = 0; i < count; i++) {
+                    outbuf_long(ob, 1 + nv_base + i);
+                    outbuf_puts(ob, i == count - 1 ? " 0\n" : " ");
+                }
                 FREE(conjbuf);
             }
         } else {
-            reducer_print_cnf(out, "inccnf", -1, -1, r);
+            reducer_print_cnf(ob, "inccnf", -1, -1, r);
+            cube_writer_t *w = cube_writer_start(r, ob, CUBES_ICNF);
             int count = 0;
             const int *a = NULL;
             while((a = reducer_get_prefix_assignment(r)) != NULL) {
                 count++;
-                fprintf(stderr, "c branch %d %d\n", count, a[2*a[0]+1]);
-                for(int i = 0; i < a[0]; i++)
-                    FPRINTF(out, 
-                            "%s%d",
-                            i == 0 ? "a " : " ",
-                            a[1+i+a[0]] == r->val[0] ?
-                            -(1+r->var_trans[a[1+i]]) :
-                            1+r->var_trans[a[1+i]]);
-                FPRINTF(out, " 0\n");
+                LOG(LOG_TRACE, "c branch %d %d\n", count, a[2*a[0]+1]);
+                cube_writer_put(w, a);
             }
+            cube_writer_finish(w);
         }
-        fprintf(stderr, 
-                "c %7s %14s %14s %14s\n",
-                "Size",
-                "Generated",
-                "Canonical",
-                "Output");
+        outbuf_free(ob);
+        LOG(LOG_INFO,
+            "c %7s %14s %14s %14s\n",
+            "Size",
+            "Generated",
+            "Canonical",
+            "Output");
         for(int l = 0; l < r->k; l++)
-            fprintf(stderr, 
-                    "c %7d %14ld %14ld %14ld\n", 
-                    l+1, 
-                    r->stat_gen[l], 
-                    r->stat_can[l],
-                    r->stat_out[l]);
+            LOG(LOG_INFO,
+                "c %7d %14ld %14ld %14ld\n", 
+                l+1, 
+                r->stat_gen[l], 
+                r->stat_can[l],
+                r->stat_out[l]);
     }
     reducer_free(r);
+    graph_cache_free();
 
-    if(fclose(out) != 0)
-        ERROR("error closing output");
-    if(fclose(in) != 0)
-        ERROR("error closing input");
+    zio_close(out);
+    if(in != NULL)
+        zio_close(in);
 
     enable_timing(); // enable timings
-    fprintf(stderr, "host: %s", common_hostname());
+    LOG(LOG_INFO, "host: %s", common_hostname());
     pop_print_time("total");
-    fprintf(stderr, "\n");
+    LOG(LOG_INFO, "\n");
 
-    fprintf(stderr, "build: %s\n", COMMITID);
+    LOG(LOG_INFO, "build: %s\n", COMMITID);
+    log_flush();
 
     arg_free(p);
 
     common_check_balance(); /* Check malloc balance to catch a memory leak. */
     return 0;
 }
+
+#endif
@@ -0,0 +1,99 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/******************************************************** Library interface. */
+
+#ifndef REDUCE_READ
+#define REDUCE_READ
+
+#include "graph.h"
+
+/* A reducer lists the assignments to a prefix of variables up to the
+ * symmetries of a vertex-colored graph; cf. 'README.txt'. The vertices
+ * are numbered from 0 and the CNF variables from 1. As in the 'reduce'
+ * program, errors terminate the process with a message, and the
+ * diagnostics on the standard error follow log_set_level(). */
+
+struct        reducer_struct;
+typedef       struct reducer_struct reducer_t;
+
+/* reducer_alloc_cnf() builds the symmetry graph from nc clauses, each a
+ * zero-terminated list of literals; with 'basic' it has one vertex per
+ * clause. reducer_alloc_graph() takes over the graph g, with the vertex
+ * colors (or NULL for one color), the variable vertices var[0..v-1], and
+ * the value vertices val[0..d-1]. Then reducer_set_cnf() may add clauses,
+ * with var_cnf[i] the CNF variable of var[i] and val[0], val[1] the
+ * values 'false' and 'true'. */
+
+reducer_t *   reducer_alloc_cnf       (int nv, long nc, const int *clauses,
+                                       int basic);
+reducer_t *   reducer_alloc_graph     (graph_t *g, const int *colors,
+                                       int v, const int *var,
+                                       int d, const int *val);
+void          reducer_set_cnf         (reducer_t *r, int nv, long nc,
+                                       const int *clauses,
+                                       const int *var_cnf);
+void          reducer_free            (reducer_t *r);
+
+/* Configuration, before the first cube. The prefix consists of variable
+ * vertices and is extended up to the target length (by default, the
+ * length of the prefix) by the selection strategy. The levels of a given
+ * prefix are computed with the set number of threads (by default 1). */
+
+void          reducer_set_prefix      (reducer_t *r, int k, const int *p);
+void          reducer_set_length      (reducer_t *r, int length);
+void          reducer_set_threshold   (reducer_t *r, long t);
+void          reducer_set_select      (reducer_t *r, const char *name);
+void          reducer_set_threads     (reducer_t *r, int threads);
+
+/* Cubes. A cube of d assignments is given, with CNF, as d literals, and
+ * otherwise as d variable vertices followed by their d values; 'aut' is
+ * the truncated order of its automorphism group. The buffer 'cube' must
+ * hold reducer_cube_capacity() ints. reducer_next_cube() returns 0 after
+ * the last cube, and on every call after that. reducer_for_each_cube() 
+ * calls f on each cube until f returns nonzero, and returns the number 
+ * of cubes. */
+
+typedef int (*reducer_cube_func_t)(void *ctx, int d, const int *cube,
+                                   int aut);
+
+int           reducer_cube_capacity   (reducer_t *r);
+int           reducer_next_cube       (reducer_t *r, int *d, int *cube,
+                                       int *aut);
+long          reducer_for_each_cube   (reducer_t *r, reducer_cube_func_t f,
+                                       void *ctx);
+
+#endif
@@ -0,0 +1,233 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/************************************* Single-producer single-consumer ring. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "common.h"
+#include "ring.h"
+
+/* The positions only grow; a record starts with its length, and a 
+ * length of -1 skips to the start of the buffer. Fields written by 
+ * the two sides are kept on separate cache lines. */
+
+#define RING_SKIP  -1
+#define RING_LINE  64
+#define RING_POLL  50   /* Longest sleep of the consumer in milliseconds. */
+
+#define LOAD(x)     __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#define STORE(x,v)  __atomic_store_n(&(x), (v), __ATOMIC_SEQ_CST)
+
+struct ring_struct
+{
+    int             *buf;
+    long             cap;
+    long             batch;
+    pthread_mutex_t  lock;
+    pthread_cond_t   room;       /* Signaled when the producer may go on. */
+    pthread_cond_t   data;       /* Signaled when the consumer may go on. */
+    char             pad0[RING_LINE];
+    long             head;       /* Published by the producer. */
+    long             next;       /* Producer: end of the reserved record. */
+    long             tail_seen;  /* Producer: last tail loaded. */
+    int              closed;
+    int              pwait;      /* The producer is about to sleep. */
+    char             pad1[RING_LINE];
+    long             tail;       /* Published by the consumer. */
+    long             rnext;      /* Consumer: end of the current record. */
+    long             head_seen;  /* Consumer: last head loaded. */
+    int              cwait;      /* The consumer is about to sleep. */
+    char             pad2[RING_LINE];
+};
+
+ring_t *ring_alloc(long capacity)
+{
+    ring_t *q = (ring_t *) MALLOC(sizeof(ring_t));
+    q->buf       = (int *) MALLOC(sizeof(int)*capacity);
+    q->cap       = capacity;
+    q->batch     = capacity/8;
+    q->head      = 0;
+    q->next      = 0;
+    q->tail_seen = 0;
+    q->closed    = 0;
+    q->pwait     = 0;
+    q->tail      = 0;
+    q->rnext     = 0;
+    q->head_seen = 0;
+    q->cwait     = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->room, NULL);
+    pthread_cond_init(&q->data, NULL);
+    return q;
+}
+
+void ring_free(ring_t *q)
+{
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->room);
+    pthread_cond_destroy(&q->data);
+    FREE(q->buf);
+    FREE(q);
+}
+
+/* Wakes the other side if it has declared that it is about to sleep. 
+ * Each side stores its position before loading the flag of the other,
+ * and sets its own flag before loading the position of the other, so 
+ * that at least one of them sees the other's store. */
+
+static void ring_wake(ring_t *q, int *flag, pthread_cond_t *c)
+{
+    pthread_mutex_lock(&q->lock);
+    STORE(*flag, 0);
+    pthread_cond_signal(c);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/***************************************************************** Producer. */
+
+int *ring_reserve(ring_t *q, int n)
+{
+    long need = n + 1;
+    if(n < 0 || 4*need > q->cap)
+        ERROR("record of %d ints does not fit in the ring", n);
+    long pos  = q->head;
+    long off  = pos % q->cap;
+    long skip = off + need > q->cap ? q->cap - off : 0;
+    if(q->cap - (pos - q->tail_seen) < skip + need) {
+        q->tail_seen = LOAD(q->tail);
+        if(q->cap - (pos - q->tail_seen) < skip + need) {
+            /* Full; wait until the consumer has made room. */
+            pthread_mutex_lock(&q->lock);
+            while(1) {
+                STORE(q->pwait, 1);
+                q->tail_seen = LOAD(q->tail);
+                if(q->cap - (pos - q->tail_seen) >= skip + need)
+                    break;
+                pthread_cond_wait(&q->room, &q->lock);
+            }
+            STORE(q->pwait, 0);
+            pthread_mutex_unlock(&q->lock);
+        }
+    }
+    if(skip > 0) {
+        q->buf[off] = RING_SKIP;
+        pos += skip;
+        off = 0;
+    }
+    q->buf[off] = n;
+    q->next = pos + need;
+    return q->buf + off + 1;
+}
+
+void ring_commit(ring_t *q)
+{
+    STORE(q->head, q->next);
+    if(LOAD(q->cwait) && q->next - q->tail_seen >= q->batch)
+        ring_wake(q, &q->cwait, &q->data);
+}
+
+void ring_close(ring_t *q)
+{
+    STORE(q->closed, 1);
+    if(LOAD(q->cwait))
+        ring_wake(q, &q->cwait, &q->data);
+}
+
+/***************************************************************** Consumer. */
+
+int *ring_next(ring_t *q, int *n)
+{
+    long pos = q->tail;
+    while(1) {
+        if(pos == q->head_seen) {
+            q->head_seen = LOAD(q->head);
+            if(pos == q->head_seen) {
+                /* Empty; wait for a batch or for the end, but look again
+                 * every RING_POLL ms so that a slow producer's records 
+                 * do not wait for the batch to fill. */
+                pthread_mutex_lock(&q->lock);
+                while(1) {
+                    STORE(q->cwait, 1);
+                    q->head_seen = LOAD(q->head);
+                    if(pos != q->head_seen || LOAD(q->closed))
+                        break;
+                    struct timespec t;
+                    clock_gettime(CLOCK_REALTIME, &t);
+                    t.tv_nsec += RING_POLL*1000000L;
+                    if(t.tv_nsec >= 1000000000L) {
+                        t.tv_sec++;
+                        t.tv_nsec -= 1000000000L;
+                    }
+                    pthread_cond_timedwait(&q->data, &q->lock, &t);
+                }
+                STORE(q->cwait, 0);
+                pthread_mutex_unlock(&q->lock);
+                /* The head is loaded after the end mark. */
+                q->head_seen = LOAD(q->head);
+                if(pos == q->head_seen)
+                    return NULL;
+            }
+        }
+        long off = pos % q->cap;
+        if(q->buf[off] != RING_SKIP) {
+            *n = q->buf[off];
+            q->rnext = pos + 1 + *n;
+            return q->buf + off + 1;
+        }
+        pos += q->cap - off;
+        STORE(q->tail, pos);
+    }
+}
+
+int ring_empty(ring_t *q)
+{
+    if(q->tail != q->head_seen)
+        return 0;
+    q->head_seen = LOAD(q->head);
+    return q->tail == q->head_seen;
+}
+
+void ring_release(ring_t *q)
+{
+    STORE(q->tail, q->rnext);
+    if(LOAD(q->pwait) && q->cap - (q->head_seen - q->rnext) >= q->cap/2)
+        ring_wake(q, &q->pwait, &q->room);
+}
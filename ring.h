@@ -0,0 +1,72 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/************************************* Single-producer single-consumer ring. */
+
+#ifndef RING_READ
+#define RING_READ
+
+/* A ring buffer of variable-length records of ints passed from one 
+ * producer thread to one consumer thread. The indices are exchanged with
+ * atomic loads and stores only; a side sleeps on a condition variable 
+ * only when the ring is full (producer) or empty (consumer), and is woken
+ * once the other side has made room for, or gathered, a batch. A waiting
+ * consumer also looks for new records every few milliseconds, so that 
+ * the records of a slow producer are passed on without a full batch. */
+
+struct        ring_struct;
+typedef       struct ring_struct ring_t;
+
+ring_t *      ring_alloc              (long capacity);
+void          ring_free               (ring_t *q);
+
+/* Producer. Reserves space for a record of n ints, publishes it, and
+ * finally marks the end of the records. */
+
+int *         ring_reserve            (ring_t *q, int n);
+void          ring_commit             (ring_t *q);
+void          ring_close              (ring_t *q);
+
+/* Consumer. Returns the next record and its length in *n, or NULL after
+ * the last record, and releases the record once it has been used. The
+ * test ring_empty() tells whether ring_next() would have to wait, for
+ * example to flush output first. */
+
+int *         ring_next               (ring_t *q, int *n);
+void          ring_release            (ring_t *q);
+int           ring_empty              (ring_t *q);
+
+#endif
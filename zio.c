@@ -0,0 +1,574 @@
+/* 
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the 
+ * aforementioned manuscript. 
+ * 
+ * The source code is subject to the following license.
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ */
+
+/************************************** Compressed input and output streams. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "common.h"
+#include "zio.h"
+
+#define ZIO_PLAIN 0
+#define ZIO_GZIP  1
+#define ZIO_XZ    2
+#define ZIO_ZSTD  3
+
+#define ZIO_CHUNK (1L<<17)
+#define ZIO_MAGIC 6
+
+static const char *codec_name[] = { "plain", "gzip", "xz", "zstd" };
+
+/* A compressed stream. The main thread owns 'f', the thread owns 'file'
+ * and 'fd' until it returns. The buffers are allocated by the main
+ * thread to keep the allocation balance out of the thread. */
+
+typedef struct zio_struct
+{
+    FILE              *f;       /* The stream handed out. */
+    FILE              *file;    /* The compressed file. */
+    int                fd;      /* The thread's end of the pipe. */
+    int                codec;
+    int                write;
+    int                stopped; /* The reader went away early. */
+    const char        *failed;  /* Error met by the thread, or NULL. */
+    char              *name;
+    unsigned char     *in;
+    unsigned char     *out;
+    unsigned char      head[ZIO_MAGIC]; /* Read ahead by zio_open(). */
+    int                head_len;
+    pthread_t          thread;
+    struct zio_struct *next;
+} zio_t;
+
+static zio_t *zio_list = NULL;
+
+/*************************************************************** Pipe ends. */
+
+/* Writes all of b to the pipe. Returns 0 if the reader has gone away,
+ * which is how the main thread stops a decompressor early. */
+
+static int pipe_put(zio_t *z, const unsigned char *b, size_t n)
+{
+    while(n > 0) {
+        ssize_t w = write(z->fd, b, n);
+        if(w < 0) {
+            if(errno == EINTR)
+                continue;
+            if(errno == EPIPE)
+                z->stopped = 1;
+            else
+                z->failed = "error writing to pipe";
+            return 0;
+        }
+        b += w;
+        n -= w;
+    }
+    return 1;
+}
+
+/* Reads at most ZIO_CHUNK bytes from the pipe; 0 at end of input. */
+
+static size_t pipe_get(zio_t *z)
+{
+    while(1) {
+        ssize_t r = read(z->fd, z->in, ZIO_CHUNK);
+        if(r >= 0)
+            return r;
+        if(errno != EINTR) {
+            z->failed = "error reading from pipe";
+            return 0;
+        }
+    }
+}
+
+static size_t file_get(zio_t *z)
+{
+    size_t h = z->head_len;
+    memcpy(z->in, z->head, h);
+    z->head_len = 0;
+    size_t n = h + fread(z->in + h, 1, ZIO_CHUNK - h, z->file);
+    if(n == h && ferror(z->file))
+        z->failed = "error reading input";
+    return n;
+}
+
+static int file_put(zio_t *z, const unsigned char *b, size_t n)
+{
+    if(n > 0 && fwrite(b, 1, n, z->file) != n) {
+        z->failed = "error writing output";
+        return 0;
+    }
+    return 1;
+}
+
+/******************************************************************** gzip. */
+
+#ifdef HAVE_ZLIB
+
+static void gzip_decompress(zio_t *z)
+{
+    z_stream s;
+    memset(&s, 0, sizeof(s));
+    if(inflateInit2(&s, 15+32) != Z_OK) {
+        z->failed = "zlib initialization failed";
+        return;
+    }
+    int done = 0;
+    while(1) {
+        if(s.avail_in == 0) {
+            s.next_in  = z->in;
+            s.avail_in = file_get(z);
+            if(s.avail_in == 0)
+                break;
+        }
+        s.next_out  = z->out;
+        s.avail_out = ZIO_CHUNK;
+        int ret = inflate(&s, Z_NO_FLUSH);
+        if(ret != Z_OK && ret != Z_STREAM_END) {
+            z->failed = "corrupt gzip data";
+            break;
+        }
+        if(!pipe_put(z, z->out, ZIO_CHUNK - s.avail_out))
+            break;
+        /* Concatenated members are read one after another. */
+        done = (ret == Z_STREAM_END);
+        if(done)
+            inflateReset(&s);
+    }
+    if(!done && !z->stopped && z->failed == NULL)
+        z->failed = "truncated gzip data";
+    inflateEnd(&s);
+}
+
+static void gzip_compress(zio_t *z)
+{
+    z_stream s;
+    memset(&s, 0, sizeof(s));
+    if(deflateInit2(&s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8,
+                    Z_DEFAULT_STRATEGY) != Z_OK) {
+        z->failed = "zlib initialization failed";
+        return;
+    }
+    int flush;
+    do {
+        s.next_in  = z->in;
+        s.avail_in = pipe_get(z);
+        flush = s.avail_in == 0 ? Z_FINISH : Z_NO_FLUSH;
+        do {
+            s.next_out  = z->out;
+            s.avail_out = ZIO_CHUNK;
+            deflate(&s, flush);
+            if(!file_put(z, z->out, ZIO_CHUNK - s.avail_out))
+                flush = Z_FINISH;
+        } while(s.avail_out == 0 && z->failed == NULL);
+    } while(flush != Z_FINISH);
+    deflateEnd(&s);
+}
+
+#endif
+
+/********************************************************************** xz. */
+
+#ifdef HAVE_LZMA
+
+static void xz_decompress(zio_t *z)
+{
+    lzma_stream s = LZMA_STREAM_INIT;
+    if(lzma_stream_decoder(&s, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        z->failed = "liblzma initialization failed";
+        return;
+    }
+    lzma_action action = LZMA_RUN;
+    while(1) {
+        if(s.avail_in == 0 && action == LZMA_RUN) {
+            s.next_in  = z->in;
+            s.avail_in = file_get(z);
+            if(s.avail_in == 0)
+                action = LZMA_FINISH;
+        }
+        s.next_out  = z->out;
+        s.avail_out = ZIO_CHUNK;
+        lzma_ret ret = lzma_code(&s, action);
+        if(ret != LZMA_OK && ret != LZMA_STREAM_END) {
+            z->failed = ret == LZMA_BUF_ERROR ? "truncated xz data"
+                                              : "corrupt xz data";
+            break;
+        }
+        if(!pipe_put(z, z->out, ZIO_CHUNK - s.avail_out) ||
+           ret == LZMA_STREAM_END)
+            break;
+    }
+    lzma_end(&s);
+}
+
+static void xz_compress(zio_t *z)
+{
+    lzma_stream s = LZMA_STREAM_INIT;
+    if(lzma_easy_encoder(&s, 6, LZMA_CHECK_CRC64) != LZMA_OK) {
+        z->failed = "liblzma initialization failed";
+        return;
+    }
+    lzma_action action = LZMA_RUN;
+    while(1) {
+        if(s.avail_in == 0 && action == LZMA_RUN) {
+            s.next_in  = z->in;
+            s.avail_in = pipe_get(z);
+            if(s.avail_in == 0)
+                action = LZMA_FINISH;
+        }
+        s.next_out  = z->out;
+        s.avail_out = ZIO_CHUNK;
+        lzma_ret ret = lzma_code(&s, action);
+        if(ret != LZMA_OK && ret != LZMA_STREAM_END) {
+            z->failed = "xz compression failed";
+            break;
+        }
+        if(!file_put(z, z->out, ZIO_CHUNK - s.avail_out) ||
+           ret == LZMA_STREAM_END)
+            break;
+    }
+    lzma_end(&s);
+}
+
+#endif
+
+/******************************************************************** zstd. */
+
+#ifdef HAVE_ZSTD
+
+static void zstd_decompress(zio_t *z)
+{
+    ZSTD_DStream *d = ZSTD_createDStream();
+    if(d == NULL || ZSTD_isError(ZSTD_initDStream(d))) {
+        z->failed = "libzstd initialization failed";
+        ZSTD_freeDStream(d);
+        return;
+    }
+    size_t left = 0; /* Nonzero while a frame is incomplete. */
+    ZSTD_inBuffer in = { z->in, 0, 0 };
+    while(z->failed == NULL && (in.size = file_get(z)) > 0) {
+        in.pos = 0;
+        ZSTD_outBuffer out;
+        do {
+            out.dst  = z->out;
+            out.size = ZIO_CHUNK;
+            out.pos  = 0;
+            left = ZSTD_decompressStream(d, &out, &in);
+            if(ZSTD_isError(left)) {
+                z->failed = "corrupt zstd data";
+                break;
+            }
+            if(!pipe_put(z, z->out, out.pos)) {
+                ZSTD_freeDStream(d);
+                return;
+            }
+        } while(in.pos < in.size || out.pos == out.size);
+    }
+    if(left != 0 && z->failed == NULL)
+        z->failed = "truncated zstd data";
+    ZSTD_freeDStream(d);
+}
+
+static void zstd_compress(zio_t *z)
+{
+    ZSTD_CStream *c = ZSTD_createCStream();
+    if(c == NULL || ZSTD_isError(ZSTD_initCStream(c, 3))) {
+        z->failed = "libzstd initialization failed";
+        ZSTD_freeCStream(c);
+        return;
+    }
+    ZSTD_inBuffer in = { z->in, 0, 0 };
+    ZSTD_outBuffer out;
+    size_t left = 1;
+    while(z->failed == NULL && (in.size = pipe_get(z)) > 0) {
+        in.pos = 0;
+        while(in.pos < in.size) {
+            out.dst  = z->out;
+            out.size = ZIO_CHUNK;
+            out.pos  = 0;
+            left = ZSTD_compressStream(c, &out, &in);
+            if(ZSTD_isError(left)) {
+                z->failed = "zstd compression failed";
+                break;
+            }
+            if(!file_put(z, z->out, out.pos))
+                break;
+        }
+    }
+    while(z->failed == NULL && left != 0) {
+        out.dst  = z->out;
+        out.size = ZIO_CHUNK;
+        out.pos  = 0;
+        left = ZSTD_endStream(c, &out);
+        if(ZSTD_isError(left))
+            z->failed = "zstd compression failed";
+        else
+            file_put(z, z->out, out.pos);
+    }
+    ZSTD_freeCStream(c);
+}
+
+#endif
+
+/******************************************************************* Plain. */
+
+/* Copies an uncompressed input whose first bytes were read ahead. */
+
+static void plain_copy(zio_t *z)
+{
+    size_t n;
+    while((n = file_get(z)) > 0)
+        if(!pipe_put(z, z->in, n))
+            break;
+}
+
+/****************************************************************** Threads. */
+
+static void *zio_thread(void *arg)
+{
+    zio_t *z = (zio_t *) arg;
+    switch(z->codec) {
+    case ZIO_PLAIN:
+        if(!z->write) plain_copy(z); else z->failed = "codec not available";
+        break;
+#ifdef HAVE_ZLIB
+    case ZIO_GZIP:
+        if(z->write) gzip_compress(z); else gzip_decompress(z);
+        break;
+#endif
+#ifdef HAVE_LZMA
+    case ZIO_XZ:
+        if(z->write) xz_compress(z); else xz_decompress(z);
+        break;
+#endif
+#ifdef HAVE_ZSTD
+    case ZIO_ZSTD:
+        if(z->write) zstd_compress(z); else zstd_decompress(z);
+        break;
+#endif
+    default:
+        z->failed = "codec not available";
+        break;
+    }
+    /* Closing our end signals end of input to a reader, or lets
+     * a writer still blocked on the pipe see that we are done. */
+    close(z->fd);
+    return NULL;
+}
+
+static int codec_available(int codec)
+{
+    switch(codec) {
+    case ZIO_PLAIN:
+        return 1;
+#ifdef HAVE_ZLIB
+    case ZIO_GZIP:
+        return 1;
+#endif
+#ifdef HAVE_LZMA
+    case ZIO_XZ:
+        return 1;
+#endif
+#ifdef HAVE_ZSTD
+    case ZIO_ZSTD:
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+/* The magic numbers of the compressed formats, indexed by the codec. */
+
+static const struct
+{
+    int           len;
+    unsigned char b[ZIO_MAGIC];
+} magic[] = {
+    { 0, { 0 } },
+    { 2, { 0x1F, 0x8B } },
+    { 6, { 0xFD, 0x37, 0x7A, 0x58, 0x5A, 0x00 } },
+    { 4, { 0x28, 0xB5, 0x2F, 0xFD } }
+};
+
+/* Reads the input for as long as it matches the magic number of a 
+ * compressed format, and returns the format on a full match, else plain.
+ * The bytes read are left in head[0], head[1], ..., head[*len-1]. */
+
+static int codec_by_magic(FILE *file, unsigned char *head, int *len)
+{
+    *len = 0;
+    int c = getc(file);
+    if(c == EOF)
+        return ZIO_PLAIN;
+    head[(*len)++] = c;
+    for(int m = ZIO_GZIP; m <= ZIO_ZSTD; m++) {
+        if(magic[m].b[0] != c)
+            continue;
+        while(*len < magic[m].len) {
+            if((c = getc(file)) == EOF)
+                return ZIO_PLAIN;
+            head[(*len)++] = c;
+            if(c != magic[m].b[*len-1])
+                return ZIO_PLAIN;
+        }
+        return m;
+    }
+    return ZIO_PLAIN;
+}
+
+static int codec_by_name(const char *name)
+{
+    static const char *ext[] = { NULL, ".gz", ".xz", ".zst" };
+    size_t n = strlen(name);
+    for(int c = ZIO_GZIP; c <= ZIO_ZSTD; c++) {
+        size_t e = strlen(ext[c]);
+        if(n > e && !strcmp(name + n - e, ext[c]))
+            return c;
+    }
+    return ZIO_PLAIN;
+}
+
+/*********************************************************** Open and close. */
+
+FILE *zio_open(const char *name, const char *mode)
+{
+    int write = (mode[0] == 'w');
+    const char *shown = name == NULL ? (write ? "stdout" : "stdin") : name;
+    int codec = ZIO_PLAIN;
+    if(write && name != NULL) {
+        codec = codec_by_name(name);
+        if(!codec_available(codec))
+            ERROR("cannot write \"%s\" since %s support is not compiled in",
+                  name, codec_name[codec]);
+    }
+    FILE *file;
+    if(name == NULL)
+        file = write ? stdout : stdin;
+    else if((file = fopen(name, write ? "wb" : "rb")) == NULL)
+        ERROR("error opening \"%s\" for %s", name, write ? "output" : "input");
+    unsigned char head[ZIO_MAGIC];
+    int head_len = 0;
+    if(!write) {
+        codec = codec_by_magic(file, head, &head_len);
+        if(!codec_available(codec))
+            ERROR("cannot read \"%s\" since %s support is not compiled in",
+                  shown, codec_name[codec]);
+        /* Plain input that only began like a magic number is given back,
+         * or else copied through a thread after the bytes read ahead. */
+        if(codec == ZIO_PLAIN) {
+            if(head_len == 1)
+                ungetc(head[0], file);
+            if(head_len <= 1 || fseek(file, -(long) head_len, SEEK_CUR) == 0)
+                head_len = 0;
+        }
+    }
+    if(codec == ZIO_PLAIN && head_len == 0)
+        return file;
+
+    int fds[2];
+    if(pipe(fds) != 0)
+        ERROR("pipe failed");
+    /* A decompressor stopped early gets EPIPE instead of a signal. */
+    signal(SIGPIPE, SIG_IGN);
+
+    zio_t *z = (zio_t *) MALLOC(sizeof(zio_t));
+    z->file    = file;
+    z->fd      = write ? fds[0] : fds[1];
+    z->codec   = codec;
+    z->write   = write;
+    z->stopped = 0;
+    z->failed  = NULL;
+    z->name    = (char *) MALLOC(strlen(shown) + 1);
+    strcpy(z->name, shown);
+    z->in      = (unsigned char *) MALLOC(ZIO_CHUNK);
+    z->out     = (unsigned char *) MALLOC(ZIO_CHUNK);
+    z->head_len = head_len;
+    memcpy(z->head, head, head_len);
+    if((z->f = fdopen(write ? fds[1] : fds[0], write ? "w" : "r")) == NULL)
+        ERROR("fdopen failed");
+    if(pthread_create(&z->thread, NULL, zio_thread, z) != 0)
+        ERROR("error creating a %s thread for \"%s\"",
+              codec_name[codec], shown);
+    z->next  = zio_list;
+    zio_list = z;
+    return z->f;
+}
+
+void zio_close(FILE *f)
+{
+    zio_t **p = &zio_list;
+    while(*p != NULL && (*p)->f != f)
+        p = &(*p)->next;
+    zio_t *z = *p;
+    if(z == NULL) {
+        if(fclose(f) != 0)
+            ERROR("error closing stream");
+        return;
+    }
+    *p = z->next;
+
+    /* Closing our end first lets a compressor see the end of its input
+     * and stops a decompressor that is still going. */
+    int bad = fclose(f) != 0;
+    pthread_join(z->thread, NULL);
+    if(z->failed != NULL)
+        ERROR("%s: %s", z->name, z->failed);
+    if(fclose(z->file) != 0)
+        bad = 1;
+    if(bad && z->write)
+        ERROR("error writing \"%s\"", z->name);
+    FREE(z->in);
+    FREE(z->out);
+    FREE(z->name);
+    FREE(z);
+}
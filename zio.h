@@ -0,0 +1,58 @@
+/*
+ * This file is part of 'reduce', an experimental software implementation of
+ * adaptive prefix-assignment symmetry reduction; cf.
+ *
+ * T. Junttila, M. Karppa, P. Kaski, J. Kohonen,
+ * "An adaptive prefix-assignment technique for symmetry reduction".
+ *
+ * This experimental source code is supplied to accompany the
+ * aforementioned manuscript.
+ *
+ * The source code is subject to the following license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2017 T. Junttila, M. Karppa, P. Kaski, J. Kohonen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/********************************************* Compressed input and output. */
+
+#ifndef ZIO_READ
+#define ZIO_READ
+
+#include <stdio.h>
+
+/* Opens a file for reading ("r") or writing ("w"), or with a NULL name
+ * the standard input or output. An input compressed with gzip, xz or zstd
+ * is detected from its magic number, an output from the extension '.gz',
+ * '.xz' or '.zst' of its name. A compressed file is read or written by
+ * a separate thread through a pipe whose other end is returned. Codecs
+ * not compiled in (cf. HAVE_ZLIB, HAVE_LZMA, HAVE_ZSTD) are errors. */
+
+FILE *        zio_open                (const char *name, const char *mode);
+
+/* Closes a stream obtained from zio_open() and waits for its thread,
+ * if any, to finish. Errors met by the thread are reported here. */
+
+void          zio_close               (FILE *f);
+
+#endif